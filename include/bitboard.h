@@ -0,0 +1,96 @@
+#ifndef _BITBOARD_H_
+#define _BITBOARD_H_
+
+#include <cstdint>
+
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
+#include "types.h"
+
+using Bitboard = uint64_t;
+
+// Squares are numbered a1 = 0 ... h8 = 63 (file + 8 * rank)
+constexpr int kSquareCount = 64;
+constexpr int kNoSquare = 64;
+
+constexpr Bitboard kFileA = 0x0101010101010101ULL;
+constexpr Bitboard kFileH = kFileA << 7;
+constexpr Bitboard kRank1 = 0xFFULL;
+constexpr Bitboard kRank2 = kRank1 << 8;
+constexpr Bitboard kRank4 = kRank1 << 24;
+constexpr Bitboard kRank5 = kRank1 << 32;
+constexpr Bitboard kRank7 = kRank1 << 48;
+constexpr Bitboard kRank8 = kRank1 << 56;
+
+inline int makeSquare(int pFile, int pRank) { return pRank * 8 + pFile; }
+inline int fileOf(int pSquare) { return pSquare & 7; }
+inline int rankOf(int pSquare) { return pSquare >> 3; }
+inline Bitboard squareBit(int pSquare) { return 1ULL << pSquare; }
+
+inline int popCount(Bitboard pBoard) { return __builtin_popcountll(pBoard); }
+inline int lsb(Bitboard pBoard) { return __builtin_ctzll(pBoard); }
+inline int popLsb(Bitboard &pBoard) {
+    int square = lsb(pBoard);
+    pBoard &= pBoard - 1;
+    return square;
+}
+
+// Fancy magic entry: occupancy bits under mMask hash to an index into mAttacks
+struct Magic {
+    Bitboard mMask;
+    Bitboard mMagic;
+    Bitboard *mAttacks;
+    unsigned mShift;
+
+    unsigned index(Bitboard pOccupied) const {
+#ifdef USE_PEXT
+        return static_cast<unsigned>(_pext_u64(pOccupied, mMask));
+#else
+        return static_cast<unsigned>(((pOccupied & mMask) * mMagic) >> mShift);
+#endif
+    }
+};
+
+class AttackTables {
+   public:
+    // Builds leaper and magic slider tables once; safe to call repeatedly
+    static void init();
+
+    static Bitboard knightAttacks(int pSquare) { return mKnightAttacks[pSquare]; }
+    static Bitboard kingAttacks(int pSquare) { return mKingAttacks[pSquare]; }
+    static Bitboard pawnAttacks(EPieceColor pColor, int pSquare) {
+        return mPawnAttacks[static_cast<int>(pColor)][pSquare];
+    }
+    static Bitboard rookAttacks(int pSquare, Bitboard pOccupied) {
+        const Magic &magic = mRookMagics[pSquare];
+        return magic.mAttacks[magic.index(pOccupied)];
+    }
+    static Bitboard bishopAttacks(int pSquare, Bitboard pOccupied) {
+        const Magic &magic = mBishopMagics[pSquare];
+        return magic.mAttacks[magic.index(pOccupied)];
+    }
+    static Bitboard queenAttacks(int pSquare, Bitboard pOccupied) {
+        return rookAttacks(pSquare, pOccupied) | bishopAttacks(pSquare, pOccupied);
+    }
+    // Squares strictly between two squares on a shared line, empty if not aligned
+    static Bitboard between(int pFrom, int pTo) { return mBetween[pFrom][pTo]; }
+    // The whole line through two aligned squares, empty if not aligned
+    static Bitboard line(int pFrom, int pTo) { return mLine[pFrom][pTo]; }
+
+   private:
+    static void initMagics(Magic pMagics[], Bitboard pTable[], const int pDirections[4][2]);
+
+    static Bitboard mKnightAttacks[kSquareCount];
+    static Bitboard mKingAttacks[kSquareCount];
+    static Bitboard mPawnAttacks[kColorCount][kSquareCount];
+    static Magic mRookMagics[kSquareCount];
+    static Magic mBishopMagics[kSquareCount];
+    static Bitboard mRookTable[0x19000];
+    static Bitboard mBishopTable[0x1480];
+    static Bitboard mBetween[kSquareCount][kSquareCount];
+    static Bitboard mLine[kSquareCount][kSquareCount];
+};
+
+#endif
@@ -3,9 +3,11 @@
 
 #include <SFML/System/Vector2.hpp>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "piece.h"
+#include "position.h"
 #include "square.h"
 
 class Board : public std::enable_shared_from_this<Board> {
@@ -21,6 +23,10 @@ class Board : public std::enable_shared_from_this<Board> {
     BoardPieces &getPieces();
     Square::SquarePtr selectSquare(sf::Vector2i pSquarePosition);
     Square::SquarePtr squareAt(sf::Vector2i pSquarePosition);
+    Square::SquarePtr squareAtIndex(int pSquareIndex);
+    void loadPosition(const Position &pPosition);
+    // Places the pieces of a FEN record; the board is left untouched if it is malformed
+    bool loadFen(const std::string &pFen);
 
    private:
     void placePiece(int pX, int pY, EPieceType pType, EPieceColor pColor);
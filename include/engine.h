@@ -5,31 +5,29 @@
 #include <SFML/System/Clock.hpp>
 #include <random>
 #include <set>
-#include <stack>
+#include <string>
 #include <vector>
 
 #include "animation_engine.h"
 #include "board.h"
 #include "common.h"
 #include "input_handler.h"
+#include "move_list.h"
+#include "opening_book.h"
 #include "piece.h"
+#include "position.h"
 #include "renderer.h"
+#include "search_job.h"
 #include "square.h"
+#include "transposition_table.h"
 
 enum class GameMode { SINGLE, ONLINE, LOCAL };
 
-enum class MoveType { NORMAL, CAPTURE, EN_PASSANT };
-
-struct Move {
-    Piece::PiecePtr mOccupier = nullptr;
-    Piece::PiecePtr mOpponent = nullptr;
-    Square::SquarePtr mFrom = nullptr;
-    Square::SquarePtr mTo = nullptr;
-    MoveType mMoveType = MoveType::NORMAL;
-    bool mFirstMove;
-    Move() = default;
-    Move(Piece::PiecePtr pPiece, Piece::PiecePtr pOpponent, Square::SquarePtr pFrom,
-         Square::SquarePtr pTo);
+// History entry kept for the GUI: the packed move plus the pieces it moved and took
+struct MoveRecord {
+    PositionMove mMove;
+    PieceCode mPiece = kNoPiece;
+    PieceCode mCaptured = kNoPiece;
 };
 
 struct Player {
@@ -45,47 +43,47 @@ class Engine {
     Renderer mRenderer;
     InputDispatcher mInputDispatcher;
     Board::BoardPtr mBoard;
+    Position mPosition;
+    TranspositionTable mTranspositionTable;
+    SearchJob mSearchJob;
+    // The last finished search, whose statistics stay in the options panel
+    SearchResult mLastSearch;
+    OpeningBook mBook;
     sf::Clock mClock;
     AnimationEngine mAnimationEngine;
     std::set<Square::SquarePtr> mLegalMoves;
     std::set<Square::SquarePtr> mCachedMoves;
     GameMode mGameMode;
-    std::stack<Move> mMoveHistory;
+    std::vector<MoveRecord> mMoveHistory;
+    // Where mMoveHistory starts, for exporting the game
+    std::string mStartFen = kStartFen;
     Player* mCurrentPlayer;
     std::random_device rd;
     std::mt19937 rng;
     const float kMovementDuration = 3.f;
 
    private:
-    std::vector<Square::SquarePtr> generatePawnMoves(Piece::PiecePtr pPiece);
-    Square::SquarePtr isEnPassant(Piece::PiecePtr pPawn);
-    std::vector<Square::SquarePtr> generateBishopMoves(Piece::PiecePtr pPiece);
-    std::vector<Square::SquarePtr> generateKnightMoves(Piece::PiecePtr pPiece);
-    std::vector<Square::SquarePtr> generateKingMoves(Piece::PiecePtr pPiece);
-    std::vector<Square::SquarePtr> generateQueenMoves(Piece::PiecePtr pPiece);
-    std::vector<Square::SquarePtr> generateRookMoves(Piece::PiecePtr pPiece);
-    std::vector<Square::SquarePtr> generateUsingCoords(
-        Piece::PiecePtr pPiece, const std::vector<std::pair<int, int>>& pCoords);
-    std::vector<Square::SquarePtr> generateMovesForPiece(
-        Piece::PiecePtr pPiece, const std::vector<sf::Vector2i>& directions);
     void copyMoves(std::vector<Square::SquarePtr> pMoves);
     void switchPlayers();
-    void makeMove(Move pMove);
+    void makeMove(const PositionMove& pMove);
     void undoMove();
-    std::vector<Move> generateAllPossibleMoves(EPieceColor pPieceColor);
+    void animateMove(const PositionMove& pMove);
+    bool findPositionMove(Square::SquarePtr pFrom, Square::SquarePtr pTo, PositionMove& pMove);
+    void syncPositionFromBoard();
+    MoveList generateAllPossibleMoves();
     int getPieceValue(EPieceType pType) const;
     int evaluateBoard() const;
-    int minimax(int pDepth, int pAlpha, int pBeta, bool pIsMaximizing);
     void makeBestMove();
+    void pollBestMove();
+    void cancelBestMove();
 #ifdef IMGUI_MODE
     void handleImGui();
 #endif
     Piece::PiecePtr findKing(EPieceColor pColor) const;
-    std::vector<Piece::PiecePtr> getOpponents(EPieceColor pColor) const;
     bool isPlayerInCheck(EPieceColor pColor);
-    bool wouldExposeKing(Move& m);
     void checkForCheckmate();
     void declareCheckmate();
+    void declareStalemate();
     void endGame();
 
    public:
@@ -104,6 +102,15 @@ class Engine {
     void highlightSquares();
     bool isLegalMove(Piece::PiecePtr pOccupier, Square::SquarePtr pTargetSquare);
     void resetEngine();
+    // Sets up the board and the search position from a FEN record, clearing
+    // the move history; returns false and changes nothing if it is malformed
+    bool loadFen(const std::string& pFen);
+    std::string fen() const;
+    // Writes the game so far as PGN; false if the file can't be written
+    bool savePgn(const std::string& pPath) const;
+    // Replays the first game of a PGN file; false and unchanged if it can't be
+    // read or holds an illegal move
+    bool loadPgn(const std::string& pPath);
 
     static Square::SquarePtr mSelectedSquare;
 };
@@ -0,0 +1,23 @@
+#ifndef _EVALUATION_H_
+#define _EVALUATION_H_
+
+#include "position.h"
+#include "types.h"
+
+// Search score bounds; every evaluation lies strictly inside the mate scores
+constexpr int kInfinity = 32000;
+constexpr int kMateScore = 30000;
+// Scores beyond this bound are mates, kMateScore less the plies to mate
+constexpr int kMateBound = kMateScore - 1000;
+
+int pieceValue(EPieceType pType);
+
+// Static evaluation in centipawns from White's point of view
+int evaluate(const Position &pPosition);
+
+// Static exchange evaluation: material the side to move gains by playing the
+// move and letting both sides keep recapturing on its target square with their
+// least valuable attacker
+int staticExchange(const Position &pPosition, const PositionMove &pMove);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped,
+// so even multi-gigabyte inputs cost no reads or copies up front and pages are
+// shared between every thread and process using the same file.
+class MappedFile {
+   public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&pOther) noexcept;
+    MappedFile &operator=(MappedFile &&pOther) noexcept;
+
+    // Replaces any file already open; returns false if the file can't be read
+    bool open(const std::string &pPath);
+    void close();
+    bool isOpen() const;
+
+    const unsigned char *data() const;
+    size_t size() const;
+    std::string_view text() const;
+
+   private:
+    const unsigned char *mData = nullptr;
+    size_t mSize = 0;
+    bool mMapped = false;
+    bool mOpen = false;
+    // Holds the contents where mapping is unavailable
+    std::vector<unsigned char> mBuffer;
+};
+
+#endif
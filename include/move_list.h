@@ -0,0 +1,37 @@
+#ifndef _MOVE_LIST_H_
+#define _MOVE_LIST_H_
+
+#include <cassert>
+#include <cstddef>
+
+#include "position.h"
+
+// Fixed-capacity move buffer meant to live on the stack, so generating moves
+// never touches the heap. 256 moves is above the 218 of the richest known
+// legal position, and the whole list fits in eight cache lines.
+class MoveList {
+   public:
+    static constexpr size_t kCapacity = 256;
+
+    void push_back(const PositionMove &pMove) {
+        assert(mSize < kCapacity);
+        mMoves[mSize++] = pMove;
+    }
+    void clear() { mSize = 0; }
+    void resize(size_t pSize) { mSize = pSize; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    PositionMove &operator[](size_t pIndex) { return mMoves[pIndex]; }
+    const PositionMove &operator[](size_t pIndex) const { return mMoves[pIndex]; }
+    PositionMove *begin() { return mMoves; }
+    PositionMove *end() { return mMoves + mSize; }
+    const PositionMove *begin() const { return mMoves; }
+    const PositionMove *end() const { return mMoves + mSize; }
+
+   private:
+    PositionMove mMoves[kCapacity];
+    size_t mSize = 0;
+};
+
+#endif
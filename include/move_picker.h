@@ -0,0 +1,53 @@
+#ifndef _MOVE_PICKER_H_
+#define _MOVE_PICKER_H_
+
+#include <cstddef>
+
+#include "move_list.h"
+#include "position.h"
+#include "types.h"
+
+// Butterfly history: how often a quiet move from one square to another has
+// caused a beta cutoff, per side. Values saturate towards +-kMaxValue.
+class HistoryTable {
+   public:
+    static constexpr int kMaxValue = 16384;
+
+    void clear();
+    int value(EPieceColor pColor, const PositionMove &pMove) const;
+    // Positive bonuses reward a cutoff, negative ones punish a move that failed to cause one
+    void update(EPieceColor pColor, const PositionMove &pMove, int pBonus);
+
+   private:
+    int mTable[kColorCount][kSquareCount][kSquareCount];
+};
+
+// Generates the moves of a node and hands them out best-first. Each call to
+// next() selects the highest scored move left, so a node that cuts off early
+// never pays for sorting the moves it does not search.
+class MovePicker {
+   public:
+    // Main search: hash move, then captures by MVV-LVA, then killers, then quiets by history
+    MovePicker(const Position &pPosition, const PositionMove &pHashMove,
+               const PositionMove *pKillers, const HistoryTable &pHistory);
+    // Quiescence search: captures and promotions by MVV-LVA, or every evasion when in check
+    MovePicker(const Position &pPosition, const HistoryTable &pHistory);
+
+    bool next(PositionMove &pMove);
+    size_t size() const;
+    // Whether the hash move was found among the legal moves
+    bool hasHashMove() const;
+
+   private:
+    void score(const PositionMove *pKillers);
+
+    const Position &mPosition;
+    const HistoryTable &mHistory;
+    PositionMove mHashMove;
+    bool mHasHashMove;
+    MoveList mMoves;
+    int mScores[MoveList::kCapacity];
+    size_t mCurrent;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _MOVEGEN_H_
+#define _MOVEGEN_H_
+
+#include <string>
+
+#include "move_list.h"
+#include "position.h"
+
+// Appends every legal move for the side to move. Pins and the squares that
+// answer a check are worked out once up front, so no move needs a trial
+// make/undo; in double check only king moves are produced.
+void generateLegalMoves(const Position &pPosition, MoveList &pMoves);
+
+// Legal captures, en passant and promotions only, for the quiescence search
+void generateLegalCaptures(const Position &pPosition, MoveList &pMoves);
+
+// Legal moves of the side to move's pieces of one type, castling included for
+// the king, so each type's share of generateLegalMoves can be timed alone
+void generateLegalPieceMoves(const Position &pPosition, EPieceType pType, MoveList &pMoves);
+
+// The legal move written in long algebraic (UCI) notation, or a null move if
+// the text names no legal move
+PositionMove parseUciMove(const Position &pPosition, const std::string &pText);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef _OPENING_BOOK_H_
+#define _OPENING_BOOK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "position.h"
+
+// Default book looked for next to the executables
+constexpr const char *kDefaultBookPath = "book.bin";
+
+// One 16-byte entry of the Polyglot .bin layout, all fields big-endian on disk
+struct BookRecord {
+    uint64_t mKey;
+    uint16_t mMove;
+    uint16_t mWeight;
+    uint32_t mLearn;
+};
+
+struct BookEntry {
+    PositionMove mMove;
+    uint16_t mWeight;
+};
+
+// Polyglot's position key, computed from scratch: its own random table, with
+// the en passant file hashed only when a pawn can take there
+uint64_t polyglotKey(const Position &pPosition);
+
+// Polyglot move encoding: to file/rank, from file/rank and promotion piece in
+// three bits each, castling written as the king taking its own rook
+uint16_t encodeBookMove(const PositionMove &pMove);
+
+// Opening book in the Polyglot .bin layout: entries sorted by position key and
+// memory-mapped, so a lookup is a binary search touching a few pages. Keys are
+// polyglotKey(), the same keys chess-book writes.
+class OpeningBook {
+   public:
+    // Replaces any book already open; false if the file is missing or isn't a
+    // whole number of entries
+    bool open(const std::string &pPath);
+    void close();
+    bool isOpen() const;
+    size_t size() const;
+
+    // The legal book moves of the position
+    std::vector<BookEntry> probe(const Position &pPosition) const;
+    // A book move chosen with probability proportional to its weight, or a
+    // null move if the position isn't in the book
+    PositionMove pick(const Position &pPosition, std::mt19937 &pRng) const;
+
+   private:
+    BookRecord record(size_t pIndex) const;
+
+    MappedFile mFile;
+};
+
+// Sorts the records by key, then by weight, and writes them as a book
+bool writeBook(const std::string &pPath, std::vector<BookRecord> &pRecords);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _PERFT_H_
+#define _PERFT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "position.h"
+
+struct PerftDivide {
+    PositionMove mMove;
+    uint64_t mNodes;
+};
+
+struct PerftCase {
+    std::string mName;
+    std::string mFen;
+    int mDepth;
+    uint64_t mNodes;
+};
+
+// Counts leaf nodes of the legal move tree. With bulk counting the last ply
+// is the size of the legal move list instead of making every leaf move.
+uint64_t perft(Position &pPosition, int pDepth, bool pBulk = true);
+std::vector<PerftDivide> perftDivide(Position &pPosition, int pDepth, bool pBulk = true);
+
+// Reference positions with published node counts
+const std::vector<PerftCase> &perftSuite();
+
+#endif
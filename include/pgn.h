@@ -0,0 +1,76 @@
+#ifndef _PGN_H_
+#define _PGN_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "position.h"
+
+// Standard algebraic notation of a legal move, with check and mate marks.
+// The position is used to test for check and is restored before returning.
+std::string moveToSan(Position &pPosition, const PositionMove &pMove);
+// The legal move a SAN token names, or a null move if it names none.
+// Annotation suffixes such as "!?" are ignored.
+PositionMove parseSanMove(const Position &pPosition, std::string_view pSan);
+
+struct PgnTag {
+    std::string_view mName;
+    // Between the quotes, with any escapes left in place
+    std::string_view mValue;
+};
+
+// One game as views into the parsed text, which must outlive it. Comments,
+// variations, NAGs and move numbers are skipped; only the SAN tokens remain.
+struct PgnGameView {
+    std::vector<PgnTag> mTags;
+    std::vector<std::string_view> mMoves;
+    std::string_view mResult;
+
+    std::string_view tag(std::string_view pName) const;
+};
+
+// Tokenises PGN text game by game without copying it
+class PgnReader {
+   public:
+    explicit PgnReader(std::string_view pText);
+    // Fills pGame with the next game; false at the end of the text
+    bool next(PgnGameView &pGame);
+
+   private:
+    void skipSpace();
+    bool readTag(PgnTag &pTag);
+
+    std::string_view mText;
+    size_t mPos;
+};
+
+// Parses the text on pThreads threads, each taking a slice that starts at a
+// game boundary, and calls pVisit for every game. Calls come from several
+// threads at once and in no particular order. Returns the number of games.
+size_t forEachPgnGame(std::string_view pText, int pThreads,
+                      const std::function<void(const PgnGameView &)> &pVisit);
+
+// Sets up the game's start position (the FEN tag if present) and resolves its
+// moves; false if a move is illegal, with pMoves holding the ones before it
+bool replayPgnGame(const PgnGameView &pGame, Position &pPosition,
+                   std::vector<PositionMove> &pMoves);
+
+// An owned game, for exporting and importing a single game
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string>> mTags;
+    std::string mStartFen = kStartFen;
+    std::vector<PositionMove> mMoves;
+    std::string mResult = "*";
+};
+
+// Writes the seven-tag roster (filling in missing tags), SetUp/FEN for
+// non-standard starts, and SAN move text wrapped at 80 columns
+std::string writePgn(const PgnGame &pGame);
+// Reads the first game of the text; false if there is none or a move is illegal
+bool readPgn(std::string_view pText, PgnGame &pGame);
+
+#endif
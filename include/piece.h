@@ -6,8 +6,7 @@
 #include <SFML/System/Vector3.hpp>
 #include <memory>
 
-enum class EPieceColor { BLACK, WHITE };
-enum class EPieceType { PAWN, ROOK, BISHOP, QUEEN, KING, KNIGHT };
+#include "types.h"
 
 class Square;
 
@@ -34,6 +33,7 @@ class Piece : public std::enable_shared_from_this<Piece> {
     void deOccupy();
     void setSquare(std::shared_ptr<Square> pSquare);
     std::string getName() const;
+    static std::string name(EPieceColor pColor, EPieceType pType);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+#ifndef _POSITION_H_
+#define _POSITION_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+#include "psqt.h"
+#include "types.h"
+
+enum class EMoveFlag : uint8_t {
+    QUIET,
+    DOUBLE_PUSH,
+    KING_CASTLE,
+    QUEEN_CASTLE,
+    CAPTURE,
+    EN_PASSANT,
+    PROMOTION,
+    PROMOTION_CAPTURE
+};
+
+constexpr const char *kStartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Castling rights bit set
+constexpr int kWhiteKingSide = 1;
+constexpr int kWhiteQueenSide = 2;
+constexpr int kBlackKingSide = 4;
+constexpr int kBlackQueenSide = 8;
+constexpr int kAllCastling = 15;
+
+// Move packed into 16 bits: from (6) | to (6) | code (4). Codes 0-5 are the
+// plain flags; promotions are 8 + piece and promotion captures 12 + piece,
+// with the piece counted knight, bishop, rook, queen.
+class PositionMove {
+   public:
+    PositionMove() = default;
+    PositionMove(int pFrom, int pTo, EMoveFlag pFlag, EPieceType pPromotion = EPieceType::QUEEN) {
+        // Promotion piece index by EPieceType (PAWN, ROOK, BISHOP, QUEEN, KING, KNIGHT)
+        constexpr int kPromotionIndex[kPieceTypeCount] = {0, 2, 1, 3, 0, 0};
+        int code = static_cast<int>(pFlag);
+        if (pFlag == EMoveFlag::PROMOTION || pFlag == EMoveFlag::PROMOTION_CAPTURE) {
+            code = (pFlag == EMoveFlag::PROMOTION ? 8 : 12) +
+                   kPromotionIndex[static_cast<int>(pPromotion)];
+        }
+        mData = static_cast<uint16_t>(pFrom | pTo << 6 | code << 12);
+    }
+    static PositionMove fromRaw(uint16_t pData) {
+        PositionMove move;
+        move.mData = pData;
+        return move;
+    }
+
+    int from() const { return mData & 63; }
+    int to() const { return (mData >> 6) & 63; }
+    EMoveFlag flag() const {
+        int code = mData >> 12;
+        if (code >= 12) return EMoveFlag::PROMOTION_CAPTURE;
+        if (code >= 8) return EMoveFlag::PROMOTION;
+        return static_cast<EMoveFlag>(code);
+    }
+    EPieceType promotion() const {
+        constexpr EPieceType kPromotionPieces[4] = {EPieceType::KNIGHT, EPieceType::BISHOP,
+                                                    EPieceType::ROOK, EPieceType::QUEEN};
+        return isPromotion() ? kPromotionPieces[(mData >> 12) & 3] : EPieceType::QUEEN;
+    }
+    uint16_t raw() const { return mData; }
+
+    // The default move (a1a1) doubles as "no move"
+    bool isNull() const { return from() == to(); }
+    bool isCapture() const {
+        int code = mData >> 12;
+        return code == static_cast<int>(EMoveFlag::CAPTURE) ||
+               code == static_cast<int>(EMoveFlag::EN_PASSANT) || code >= 12;
+    }
+    bool isPromotion() const { return (mData >> 12) >= 8; }
+    bool operator==(const PositionMove &pOther) const { return mData == pOther.mData; }
+    bool operator!=(const PositionMove &pOther) const { return mData != pOther.mData; }
+
+   private:
+    uint16_t mData = 0;
+};
+static_assert(sizeof(PositionMove) == 2, "moves must stay packed");
+
+std::string squareName(int pSquare);
+int parseSquare(const std::string &pName);
+// Long algebraic (UCI) notation such as e2e4 or e7e8q
+std::string moveToUci(const PositionMove &pMove);
+
+// Irreversible state of one ply: everything undoMove can't recompute, plus the
+// key and checkers so they need not be recomputed either
+struct PositionState {
+    uint64_t mKey = 0;
+    // Pieces giving check to the side to move
+    Bitboard mCheckers = 0;
+    // The move that led here and the piece it captured
+    PositionMove mMove;
+    PieceCode mCaptured = kNoPiece;
+    uint8_t mCastlingRights = 0;
+    uint8_t mEnPassant = kNoSquare;
+    uint16_t mHalfmoveClock = 0;
+};
+
+// Ply-indexed stack of states holding exactly the plies in use. Copies, such as
+// each search thread's root, reserve kHeadroomPlies beyond them, so the search
+// that follows never reallocates however long the game before it was.
+class PositionStateStack {
+   public:
+    // More than any search goes deep, null moves and quiescence included
+    static constexpr int kHeadroomPlies = 256;
+
+    PositionStateStack() = default;
+    PositionStateStack(const PositionStateStack &pOther) { *this = pOther; }
+    PositionStateStack(PositionStateStack &&pOther) = default;
+    PositionStateStack &operator=(const PositionStateStack &pOther) {
+        if (this != &pOther) {
+            mStates.reserve(pOther.mStates.size() + kHeadroomPlies);
+            mStates.assign(pOther.mStates.begin(), pOther.mStates.end());
+        }
+        return *this;
+    }
+    PositionStateStack &operator=(PositionStateStack &&pOther) = default;
+
+    // Leaves a single empty state
+    void reset() {
+        mStates.clear();
+        mStates.reserve(kHeadroomPlies);
+        mStates.emplace_back();
+    }
+    // Pushes a copy of the top state
+    void push() { mStates.push_back(mStates.back()); }
+    void pop() { mStates.pop_back(); }
+    PositionState &operator[](int pPly) { return mStates[pPly]; }
+    const PositionState &operator[](int pPly) const { return mStates[pPly]; }
+
+   private:
+    std::vector<PositionState> mStates;
+};
+
+// Value-type bitboard position used by move generation, evaluation and search.
+// The GUI Board is only synchronised from it for display.
+class Position {
+   public:
+    Position();
+    void clear();
+    void setStartPosition();
+    // Loads a FEN record; returns false and leaves the position cleared on malformed input
+    bool setFromFen(const std::string &pFen);
+    // The position as a six-field FEN record
+    std::string toFen() const;
+
+    void putPiece(int pSquare, EPieceColor pColor, EPieceType pType);
+    void removePiece(int pSquare);
+    void makeMove(const PositionMove &pMove);
+    void undoMove();
+    // Passes the turn, for null-move pruning; never while in check
+    void makeNullMove();
+    void undoNullMove();
+    bool canUndo() const;
+
+    Bitboard pieces(EPieceColor pColor, EPieceType pType) const;
+    Bitboard pieces(EPieceColor pColor) const;
+    Bitboard occupied() const;
+    PieceCode pieceAt(int pSquare) const;
+    // Piece removed by the move, including the pawn taken en passant
+    PieceCode capturedPiece(const PositionMove &pMove) const;
+    int kingSquare(EPieceColor pColor) const;
+    // Zobrist key, maintained incrementally by makeMove/undoMove
+    uint64_t key() const;
+    // Material and piece-square sum from White's point of view, maintained like the key
+    const ScorePair &psqScore() const;
+    // Remaining non-pawn material, PieceSquareTable::kMaxPhase at the start
+    int gamePhase() const;
+
+    EPieceColor sideToMove() const;
+    int castlingRights() const;
+    int enPassantSquare() const;
+    int halfmoveClock() const;
+    int fullmoveNumber() const;
+    void setSideToMove(EPieceColor pColor);
+    void setCastlingRights(int pRights);
+    void setEnPassantSquare(int pSquare);
+    void setHalfmoveClock(int pClock);
+    void setFullmoveNumber(int pNumber);
+
+    // Pieces of either color attacking the square under the given occupancy
+    Bitboard attackersTo(int pSquare, Bitboard pOccupied) const;
+    // Looks outward from the square with leaper tables and slider rays
+    bool isSquareAttacked(int pSquare, EPieceColor pByColor) const;
+    // Cached after every move, so asking about the side to move is free
+    Bitboard checkers() const;
+    bool isInCheck(EPieceColor pColor) const;
+
+   private:
+    uint64_t computeKey() const;
+    Bitboard computeCheckers() const;
+
+    Bitboard mPieceBoards[kColorCount][kPieceTypeCount];
+    Bitboard mColorBoards[kColorCount];
+    PieceCode mMailbox[kSquareCount];
+    EPieceColor mSideToMove;
+    int mFullmoveNumber;
+    ScorePair mPsqScore;
+    int mGamePhase;
+    // mStates[mPly] describes the current position
+    PositionStateStack mStates;
+    int mPly;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _PSQT_H_
+#define _PSQT_H_
+
+#include "bitboard.h"
+#include "types.h"
+
+// Midgame/endgame pair of evaluation terms, blended by game phase at the leaf
+struct ScorePair {
+    int mMidgame = 0;
+    int mEndgame = 0;
+
+    ScorePair &operator+=(const ScorePair &pOther) {
+        mMidgame += pOther.mMidgame;
+        mEndgame += pOther.mEndgame;
+        return *this;
+    }
+    ScorePair &operator-=(const ScorePair &pOther) {
+        mMidgame -= pOther.mMidgame;
+        mEndgame -= pOther.mEndgame;
+        return *this;
+    }
+};
+
+// Material plus piece-square bonuses for every piece on every square, signed
+// from White's point of view so a position can keep their sum up to date
+// piece by piece.
+class PieceSquareTable {
+   public:
+    // Phase of a full set of pieces; it counts down towards the endgame
+    static constexpr int kMaxPhase = 24;
+
+    // Fills the tables; safe to call repeatedly
+    static void init();
+
+    static const ScorePair &value(PieceCode pPiece, int pSquare) { return mValues[pPiece][pSquare]; }
+    static int phase(PieceCode pPiece) { return mPhases[pPiece]; }
+
+   private:
+    static ScorePair mValues[kColorCount * kPieceTypeCount][kSquareCount];
+    static int mPhases[kColorCount * kPieceTypeCount];
+};
+
+#endif
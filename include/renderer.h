@@ -2,6 +2,7 @@
 #define _RENDERER_H_
 
 #include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 
 #include "SFML/System/Clock.hpp"
@@ -18,6 +19,9 @@ class Renderer {
     ~Renderer();
     void drawSquare(Square::SquarePtr pSquare);
     void drawBoard(Board::BoardPtr pBoard, bool pAnimating);
+    // The squares and pieces of one frame, onto any target; chess-bench draws
+    // them offscreen
+    static void drawSquares(sf::RenderTarget& pTarget, Board::BoardPtr pBoard);
     void update();
     void setDrawFlag();
     bool isRunning() const;
@@ -0,0 +1,215 @@
+#ifndef _SEARCH_H_
+#define _SEARCH_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "move_list.h"
+#include "move_picker.h"
+#include "position.h"
+#include "transposition_table.h"
+
+struct SearchLimits {
+    int mMaxDepth = 64;
+    // No new iteration is started once the soft limit has passed
+    int64_t mSoftTimeMs = 0;
+    // The running iteration is abandoned at the hard limit
+    int64_t mHardTimeMs = 0;
+    uint64_t mMaxNodes = 0;
+};
+
+// Selective search features, each switchable to measure its effect on node counts
+struct SearchOptions {
+    bool mPrincipalVariationSearch = true;
+    bool mAspirationWindows = true;
+    bool mNullMovePruning = true;
+    bool mLateMoveReductions = true;
+    bool mCheckExtensions = true;
+};
+
+// Nodes and time at the end of one completed iteration of the main thread
+struct SearchIteration {
+    int mDepth = 0;
+    uint64_t mNodes = 0;  // counted from the start of the search
+    int64_t mTimeMs = 0;
+};
+
+// Counters for tuning move ordering and pruning, summed over every thread
+struct SearchStats {
+    // Beta cutoffs by the position of the cutting move in its node's ordering;
+    // the last bucket collects every later move
+    static constexpr int kCutoffBuckets = 8;
+
+    uint64_t mNodes = 0;
+    uint64_t mQuiescenceNodes = 0;
+    uint64_t mTableProbes = 0;
+    uint64_t mTableHits = 0;
+    uint64_t mTableCutoffs = 0;
+    uint64_t mCutoffs[kCutoffBuckets] = {};
+    // Hash moves from another position sharing the table slot, found illegal here
+    uint64_t mHashMoveRejects = 0;
+    // Quiescence captures skipped by delta pruning and by a losing exchange
+    uint64_t mDeltaPrunes = 0;
+    uint64_t mSeePrunes = 0;
+    std::vector<SearchIteration> mIterations;
+
+    void add(const SearchStats &pOther);
+    uint64_t cutoffs() const;
+    // Share of beta cutoffs caused by the first move searched
+    double firstMoveCutoffRate() const;
+    // Nodes of the last iteration over those of the one before, 0 until two
+    // iterations have completed
+    double effectiveBranchingFactor() const;
+};
+
+struct SearchResult {
+    PositionMove mBestMove;
+    // Root moves that scored the same as the best move, best move included
+    std::vector<PositionMove> mTiedMoves;
+    std::vector<PositionMove> mPrincipalVariation;
+    int mScore = 0;  // from the side to move's point of view
+    int mDepth = 0;
+    uint64_t mNodes = 0;
+    int64_t mTimeMs = 0;
+    SearchStats mStats;
+};
+
+// Snapshot of a running search, safe to take from another thread
+struct SearchProgress {
+    PositionMove mBestMove;
+    int mScore = 0;
+    int mDepth = 0;  // last completed iteration of the main thread
+    uint64_t mNodes = 0;
+    int64_t mTimeMs = 0;
+    SearchStats mStats;
+};
+
+uint64_t nodesPerSecond(uint64_t pNodes, int64_t pTimeMs);
+// One line of JSON with the outcome of a search and its statistics
+std::string searchStatsJson(const SearchResult &pResult);
+
+class Search;
+
+// One search thread. Each worker owns a copy of the root position and its own
+// root move list; workers only share the transposition table and stop flag.
+class SearchWorker {
+   public:
+    SearchWorker(Search &pSearch, int pId);
+    // Iterative deepening until the depth limit is reached or the search stops
+    void run(const Position &pRoot);
+    const SearchResult &result() const;
+    uint64_t nodes() const;
+    // Adds this worker's counters; safe to call while it runs
+    void addStats(SearchStats &pStats) const;
+
+   private:
+    // Bound on the distance from the root, quiescence included
+    static constexpr int kMaxPly = 128;
+
+    // Written by this worker only and read by other threads, like mNodes
+    struct StatCounters {
+        std::atomic<uint64_t> mQuiescenceNodes{0};
+        std::atomic<uint64_t> mTableProbes{0};
+        std::atomic<uint64_t> mTableHits{0};
+        std::atomic<uint64_t> mTableCutoffs{0};
+        std::atomic<uint64_t> mCutoffs[SearchStats::kCutoffBuckets] = {};
+        std::atomic<uint64_t> mHashMoveRejects{0};
+        std::atomic<uint64_t> mDeltaPrunes{0};
+        std::atomic<uint64_t> mSeePrunes{0};
+    };
+
+    struct RootMove {
+        PositionMove mMove;
+        int mScore;
+    };
+
+    bool isMainThread() const;
+    // One iteration, with aspiration windows re-searched until the score fits
+    bool searchRoot(int pDepth);
+    // Searches the root moves in the window, collecting the moves tied for best
+    int searchRootMoves(int pDepth, int pAlpha, int pBeta, MoveList &pTied);
+    // Principal variation search; scores are from the side to move's point of view
+    int negamax(int pDepth, int pPly, int pAlpha, int pBeta, bool pAllowNull);
+    // Resolves captures past the horizon so the static score is only taken in
+    // quiet positions
+    int quiescence(int pPly, int pAlpha, int pBeta);
+    void updateQuietStats(const PositionMove &pMove, const MoveList &pQuietsTried, int pDepth,
+                          int pPly);
+    void countNode();
+    static void increment(std::atomic<uint64_t> &pCounter);
+    bool shouldStop();
+    void extractPrincipalVariation(const PositionMove &pBestMove, int pDepth,
+                                   std::vector<PositionMove> &pLine);
+
+    Search &mSearch;
+    int mId;
+    Position mPosition;
+    // Written by this worker only; read by the main thread for the node limit
+    std::atomic<uint64_t> mNodes;
+    StatCounters mStats;
+    bool mFollowPv;
+    // Depth of the running iteration, which bounds the check extensions
+    int mRootDepth;
+    std::vector<RootMove> mRootMoves;
+    std::vector<PositionMove> mPreviousPv;
+    // Quiet moves that caused a beta cutoff, two per ply
+    PositionMove mKillers[kMaxPly][2];
+    HistoryTable mHistory;
+    SearchResult mResult;
+};
+
+// Lazy SMP search: every thread runs the same iterative deepening on its own
+// copy of the position, and they speed each other up through the shared
+// transposition table. The calling thread acts as the main worker and owns the
+// clock; when it stops, the helpers are stopped and the best move is voted on.
+class Search {
+   public:
+    static constexpr int kMaxDepth = 64;
+    static constexpr int kMaxThreads = 256;
+
+    explicit Search(TranspositionTable &pTable, int pThreads = 1,
+                    const SearchOptions &pOptions = SearchOptions());
+    SearchResult run(const Position &pPosition, const SearchLimits &pLimits);
+    // Safe to call from any thread. A stop issued before run() starts is honoured,
+    // so a search can be cancelled without racing its start-up.
+    void stop();
+    SearchProgress progress() const;
+    // Counters of every worker, and the iterations completed so far
+    SearchStats stats() const;
+    // Called on the main search thread after each completed iteration, with the
+    // node count and time filled in; set before run()
+    using IterationCallback = std::function<void(const SearchResult &)>;
+    void setIterationCallback(IterationCallback pCallback);
+    uint64_t nodes() const;
+    int64_t elapsedMs() const;
+
+   private:
+    friend class SearchWorker;
+
+    SearchResult selectBestResult() const;
+    // Callers hold mProgressMutex
+    SearchStats collectStats() const;
+    void reportIteration(const SearchResult &pResult);
+
+    TranspositionTable &mTable;
+    int mThreadCount;
+    SearchOptions mOptions;
+    SearchLimits mLimits;
+    std::chrono::steady_clock::time_point mStart;
+    std::atomic<bool> mStopped;
+    // Guards the worker list while it is rebuilt, the progress snapshot and the
+    // iteration log
+    mutable std::mutex mProgressMutex;
+    SearchProgress mProgress;
+    std::vector<SearchIteration> mIterations;
+    IterationCallback mIterationCallback;
+    std::vector<std::unique_ptr<SearchWorker>> mWorkers;
+};
+
+#endif
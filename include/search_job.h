@@ -0,0 +1,43 @@
+#ifndef _SEARCH_JOB_H_
+#define _SEARCH_JOB_H_
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "position.h"
+#include "search.h"
+#include "transposition_table.h"
+
+// Runs a Search on a background thread so the caller's loop keeps running.
+// The owner polls takeResult() once per iteration of its own loop; cancel()
+// stops and joins the search and throws its result away.
+class SearchJob {
+   public:
+    explicit SearchJob(TranspositionTable &pTable);
+    ~SearchJob();
+    SearchJob(const SearchJob &) = delete;
+    SearchJob &operator=(const SearchJob &) = delete;
+
+    // Cancels any search still running, then searches a copy of pPosition
+    void start(const Position &pPosition, const SearchLimits &pLimits, int pThreads,
+               const SearchOptions &pOptions = SearchOptions());
+    // True from start() until the result has been taken or the job cancelled
+    bool isRunning() const;
+    // Non-blocking; returns true exactly once per finished search
+    bool takeResult(SearchResult &pResult);
+    // Asks the search to finish early; its best move so far still arrives via takeResult()
+    void stop();
+    void cancel();
+    SearchProgress progress() const;
+
+   private:
+    TranspositionTable &mTable;
+    std::unique_ptr<Search> mSearch;
+    std::thread mThread;
+    std::atomic<bool> mFinished;
+    Position mPosition;
+    SearchResult mResult;
+};
+
+#endif
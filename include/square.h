@@ -27,6 +27,7 @@ class Square : public std::enable_shared_from_this<Square> {
     Square(int pX, int pY, EPieceColor pColor);
     int getX() const;
     int getY() const;
+    int getIndex() const;
     EPieceColor getSquareColor() const;
     bool isOccupied() const;
     bool isSelected() const;
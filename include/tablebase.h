@@ -0,0 +1,51 @@
+#ifndef _TABLEBASE_H_
+#define _TABLEBASE_H_
+
+#include <string>
+#include <vector>
+
+#include "evaluation.h"
+#include "position.h"
+
+// Default tablebase directory, relative to where the executables run
+constexpr const char *kDefaultTablebasePath = "tablebases";
+
+// Syzygy endgame tablebases. The win/draw/loss tables (.rtbw) are probed in the
+// search, the distance-to-zeroing tables (.rtbz) pick the root move. Files are
+// memory-mapped once and shared read-only by every search thread.
+class Tablebases {
+   public:
+    // Win/draw/loss results for the side to move. Cursed wins and blessed
+    // losses are won or lost on the board but drawn by the fifty-move rule.
+    static constexpr int kLoss = -2;
+    static constexpr int kBlessedLoss = -1;
+    static constexpr int kDraw = 0;
+    static constexpr int kCursedWin = 1;
+    static constexpr int kWin = 2;
+    // Score of a tablebase win less the ply it is found at: below every mate,
+    // above every evaluation
+    static constexpr int kWinScore = kMateBound - 256;
+
+    // Maps every table in the directories, separated like PATH, replacing
+    // those mapped before, and returns how many were found. Not safe while a
+    // search is running.
+    static int init(const std::string &pPaths);
+    // Win/draw/loss tables currently mapped
+    static int count();
+    // Most pieces, kings included, in any mapped table; 0 without tables
+    static int maxPieces();
+
+    // Result of the position with the fifty-move counter at zero. False if no
+    // table covers it, or it still has castling rights.
+    static bool probeWdl(Position &pPosition, int &pWdl);
+    // Plies to the next capture or pawn move on the best line, negative when
+    // losing and 0 for draws; the fifty-move counter isn't taken into account
+    static bool probeDtz(Position &pPosition, int &pDtz);
+    // The root moves keeping the best result under the fifty-move rule,
+    // reaching the next zeroing move soonest when winning and latest when
+    // losing, and the score they lead to
+    static bool probeRoot(Position &pPosition, std::vector<PositionMove> &pBestMoves,
+                          int &pScore);
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef _TRANSPOSITION_TABLE_H_
+#define _TRANSPOSITION_TABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "position.h"
+
+enum class EBound : uint8_t { NONE, EXACT, LOWER, UPPER };
+
+struct TTEntry {
+    PositionMove mMove;
+    int16_t mScore = 0;
+    int8_t mDepth = 0;
+    EBound mBound = EBound::NONE;
+    uint8_t mGeneration = 0;
+};
+
+// Fixed-size hash table of search results keyed by Zobrist key, shared by all
+// search threads without locks. Each slot stores its packed data next to
+// key ^ data, so a slot torn by concurrent writers fails verification and
+// reads as a miss. Slots are grouped four to a cache line; a store replaces
+// the same position or else the slot that is shallowest and oldest.
+class TranspositionTable {
+   public:
+    static constexpr size_t kDefaultMegabytes = 16;
+
+    explicit TranspositionTable(size_t pMegabytes = kDefaultMegabytes);
+    void resize(size_t pMegabytes);
+    void clear();
+    // Ages existing entries so they are preferred for replacement
+    void newSearch();
+    bool probe(uint64_t pKey, TTEntry &pEntry) const;
+    void store(uint64_t pKey, int pDepth, int pScore, EBound pBound, const PositionMove &pMove);
+    size_t sizeInMegabytes() const;
+    // Permille of sampled entries written during the current search
+    int hashfull() const;
+
+   private:
+    static constexpr int kBucketSize = 4;
+    struct Slot {
+        std::atomic<uint64_t> mKeyXorData;
+        std::atomic<uint64_t> mData;
+    };
+    struct alignas(64) Bucket {
+        Slot mSlots[kBucketSize];
+    };
+
+    static uint64_t pack(const TTEntry &pEntry);
+    static TTEntry unpack(uint64_t pData);
+    Bucket &bucketFor(uint64_t pKey) const;
+    int age(const TTEntry &pEntry) const;
+
+    std::unique_ptr<Bucket[]> mBuckets;
+    size_t mBucketCount;
+    size_t mMegabytes;
+    uint8_t mGeneration;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _TYPES_H_
+#define _TYPES_H_
+
+#include <cstdint>
+
+enum class EPieceColor { BLACK, WHITE };
+enum class EPieceType { PAWN, ROOK, BISHOP, QUEEN, KING, KNIGHT };
+
+constexpr int kColorCount = 2;
+constexpr int kPieceTypeCount = 6;
+
+// Compact colored piece code used by the search position: color * 6 + type
+using PieceCode = int8_t;
+constexpr PieceCode kNoPiece = -1;
+
+inline EPieceColor operator~(EPieceColor pColor) {
+    return pColor == EPieceColor::WHITE ? EPieceColor::BLACK : EPieceColor::WHITE;
+}
+
+inline PieceCode makePiece(EPieceColor pColor, EPieceType pType) {
+    return static_cast<PieceCode>(static_cast<int>(pColor) * kPieceTypeCount +
+                                  static_cast<int>(pType));
+}
+
+inline EPieceColor pieceColor(PieceCode pPiece) {
+    return static_cast<EPieceColor>(pPiece / kPieceTypeCount);
+}
+
+inline EPieceType pieceType(PieceCode pPiece) {
+    return static_cast<EPieceType>(pPiece % kPieceTypeCount);
+}
+
+#endif
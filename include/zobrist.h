@@ -0,0 +1,28 @@
+#ifndef _ZOBRIST_H_
+#define _ZOBRIST_H_
+
+#include <cstdint>
+
+#include "bitboard.h"
+#include "types.h"
+
+class Zobrist {
+   public:
+    // Fills the key tables from a fixed seed; safe to call repeatedly
+    static void init();
+
+    static uint64_t piece(PieceCode pPiece, int pSquare) { return mPieceKeys[pPiece][pSquare]; }
+    static uint64_t castling(int pRights) { return mCastlingKeys[pRights]; }
+    static uint64_t enPassant(int pSquare) {
+        return pSquare == kNoSquare ? 0 : mEnPassantKeys[fileOf(pSquare)];
+    }
+    static uint64_t side() { return mSideKey; }
+
+   private:
+    static uint64_t mPieceKeys[kColorCount * kPieceTypeCount][kSquareCount];
+    static uint64_t mCastlingKeys[16];
+    static uint64_t mEnPassantKeys[8];
+    static uint64_t mSideKey;
+};
+
+#endif
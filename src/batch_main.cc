@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "evaluation.h"
+#include "position.h"
+#include "search.h"
+#include "transposition_table.h"
+
+static const char *kUsage =
+    "usage: chess-batch [options] <file>   analyse every EPD/FEN line of a file ('-' for stdin)\n"
+    "options:\n"
+    "       --depth <n>           search each position to this depth (default 8)\n"
+    "       --nodes <n>           stop each search after this many nodes\n"
+    "       --jobs <n>            positions analysed in parallel (default: all cores)\n"
+    "       --hash <mb>           transposition table per job (default 8, or as\n"
+    "                             little as a --nodes budget can fill)\n"
+    "       --format csv|jsonl    output format (default csv)\n"
+    "       --output <file>       write results here instead of stdout\n";
+
+static constexpr int kDefaultDepth = 8;
+static constexpr size_t kDefaultHashMegabytes = 8;
+// A search stores at most one 16-byte table entry per node
+static constexpr size_t kBytesPerNode = 16;
+
+// One input line, numbered in file order
+struct BatchTask {
+    size_t mIndex;
+    std::string mLine;
+};
+
+struct BatchOptions {
+    SearchLimits mLimits;
+    int mJobs = 1;
+    size_t mHashMegabytes = kDefaultHashMegabytes;
+    bool mJson = false;
+};
+
+static std::string csvField(const std::string &pText) {
+    if (pText.find_first_of(",\"\n") == std::string::npos) {
+        return pText;
+    }
+    std::string quoted = "\"";
+    for (char c : pText) {
+        quoted += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+static std::string jsonString(const std::string &pText) {
+    std::string escaped = "\"";
+    for (char c : pText) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) >= 0x20) {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped + "\"";
+}
+
+// Splits a line into the position and the EPD id opcode, if any. EPD records
+// carry four position fields followed by opcodes; FEN records add the two
+// move counters instead.
+static void splitRecord(const std::string &pLine, std::string &pFen, std::string &pId) {
+    std::istringstream stream(pLine);
+    std::vector<std::string> fields;
+    std::string field;
+    while (fields.size() < 6 && stream >> field) {
+        fields.push_back(field);
+    }
+    size_t positionFields = std::min<size_t>(fields.size(), 4);
+    auto isNumber = [](const std::string &pText) {
+        return !pText.empty() && std::all_of(pText.begin(), pText.end(), [](char c) {
+                   return std::isdigit(static_cast<unsigned char>(c)) != 0;
+               });
+    };
+    if (fields.size() == 6 && isNumber(fields[4]) && isNumber(fields[5])) {
+        positionFields = 6;
+    }
+    pFen.clear();
+    for (size_t i = 0; i < positionFields; i++) {
+        pFen += (i ? " " : "") + fields[i];
+    }
+
+    pId.clear();
+    size_t id = pLine.find(" id ");
+    if (id != std::string::npos) {
+        size_t begin = pLine.find_first_not_of(' ', id + 4);
+        if (begin != std::string::npos && pLine[begin] == '"') {
+            size_t end = pLine.find('"', begin + 1);
+            pId = pLine.substr(begin + 1, end == std::string::npos ? end : end - begin - 1);
+        } else if (begin != std::string::npos) {
+            pId = pLine.substr(begin, pLine.find(';', begin) - begin);
+        }
+    }
+}
+
+// Streams positions to a pool of workers, each with its own search and table,
+// and writes their results back in input order. Only a bounded window of
+// positions is in flight, so the input can be arbitrarily long.
+class BatchRunner {
+   public:
+    BatchRunner(const BatchOptions &pOptions, std::FILE *pOutput);
+    void run(std::istream &pInput);
+
+   private:
+    void work();
+    std::string analyse(TranspositionTable &pTable, const BatchTask &pTask);
+    void finish(size_t pIndex, std::string pRecord);
+
+    const BatchOptions &mOptions;
+    std::FILE *mOutput;
+    size_t mMaxInFlight;
+
+    std::mutex mMutex;
+    std::condition_variable mTaskReady;
+    std::condition_variable mWindowOpen;
+    std::queue<BatchTask> mTasks;
+    bool mInputDone;
+    // Finished records waiting for the ones before them
+    std::map<size_t, std::string> mFinished;
+    size_t mNextToWrite;
+};
+
+BatchRunner::BatchRunner(const BatchOptions &pOptions, std::FILE *pOutput)
+    : mOptions(pOptions)
+    , mOutput(pOutput)
+    , mMaxInFlight(static_cast<size_t>(pOptions.mJobs) * 16)
+    , mInputDone(false)
+    , mNextToWrite(0) {}
+
+void BatchRunner::run(std::istream &pInput) {
+    if (!mOptions.mJson) {
+        std::fputs("index,id,fen,bestmove,score_cp,mate,depth,nodes,time_ms,error\n", mOutput);
+    }
+    std::vector<std::thread> workers;
+    for (int i = 0; i < mOptions.mJobs; i++) {
+        workers.emplace_back(&BatchRunner::work, this);
+    }
+
+    std::string line;
+    size_t index = 0;
+    while (std::getline(pInput, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        // A slow position at the head of the window holds the reader back
+        // rather than letting finished records pile up behind it
+        mWindowOpen.wait(lock, [&] { return index - mNextToWrite < mMaxInFlight; });
+        mTasks.push({index++, line});
+        mTaskReady.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mInputDone = true;
+    }
+    mTaskReady.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void BatchRunner::work() {
+    TranspositionTable table(mOptions.mHashMegabytes);
+    while (true) {
+        BatchTask task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mTaskReady.wait(lock, [this] { return !mTasks.empty() || mInputDone; });
+            if (mTasks.empty()) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop();
+        }
+        finish(task.mIndex, analyse(table, task));
+    }
+}
+
+std::string BatchRunner::analyse(TranspositionTable &pTable, const BatchTask &pTask) {
+    std::string fen, id, error;
+    splitRecord(pTask.mLine, fen, id);
+
+    Position position;
+    SearchResult result;
+    if (position.setFromFen(fen)) {
+        // A fresh table keeps every result independent of which positions the
+        // job happened to analyse before, so reruns reproduce it exactly
+        pTable.clear();
+        Search search(pTable, 1);
+        result = search.run(position, mOptions.mLimits);
+    } else {
+        error = "invalid position";
+    }
+
+    const bool hasMove = !result.mBestMove.isNull();
+    const bool isMate = std::abs(result.mScore) >= kMateBound;
+    int mate = 0;
+    if (isMate) {
+        int moves = (kMateScore - std::abs(result.mScore) + 1) / 2;
+        mate = result.mScore > 0 ? moves : -moves;
+    }
+    std::ostringstream record;
+    if (mOptions.mJson) {
+        record << "{\"index\":" << pTask.mIndex << ",\"id\":" << jsonString(id)
+               << ",\"fen\":" << jsonString(fen) << ",\"bestmove\":"
+               << (hasMove ? jsonString(moveToUci(result.mBestMove)) : "null")
+               << ",\"score_cp\":" << (isMate ? 0 : result.mScore)
+               << ",\"mate\":" << (isMate ? std::to_string(mate) : "null")
+               << ",\"depth\":" << result.mDepth << ",\"nodes\":" << result.mNodes
+               << ",\"time_ms\":" << result.mTimeMs
+               << ",\"error\":" << (error.empty() ? "null" : jsonString(error)) << "}\n";
+    } else {
+        record << pTask.mIndex << "," << csvField(id) << "," << csvField(fen) << ","
+               << (hasMove ? moveToUci(result.mBestMove) : "") << ","
+               << (isMate ? "" : std::to_string(result.mScore)) << ","
+               << (isMate ? std::to_string(mate) : "") << "," << result.mDepth << ","
+               << result.mNodes << "," << result.mTimeMs << "," << csvField(error) << "\n";
+    }
+    return record.str();
+}
+
+void BatchRunner::finish(size_t pIndex, std::string pRecord) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFinished.emplace(pIndex, std::move(pRecord));
+    bool advanced = false;
+    for (auto it = mFinished.begin(); it != mFinished.end() && it->first == mNextToWrite;
+         it = mFinished.erase(it)) {
+        std::fputs(it->second.c_str(), mOutput);
+        mNextToWrite++;
+        advanced = true;
+    }
+    if (advanced) {
+        mWindowOpen.notify_one();
+    }
+}
+
+int main(int argc, char **argv) {
+    BatchOptions options;
+    options.mLimits.mMaxDepth = 0;
+    options.mJobs = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::string inputPath, outputPath;
+    bool hashGiven = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--depth") && hasValue) {
+            options.mLimits.mMaxDepth = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--nodes") && hasValue) {
+            options.mLimits.mMaxNodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "--jobs") && hasValue) {
+            options.mJobs = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--hash") && hasValue) {
+            options.mHashMegabytes = std::max(1, std::atoi(argv[++i]));
+            hashGiven = true;
+        } else if (!std::strcmp(argv[i], "--format") && hasValue) {
+            const char *format = argv[++i];
+            if (std::strcmp(format, "csv") && std::strcmp(format, "jsonl")) {
+                std::fprintf(stderr, "unknown format %s\n", format);
+                std::fputs(kUsage, stderr);
+                return 2;
+            }
+            options.mJson = !std::strcmp(format, "jsonl");
+        } else if (!std::strcmp(argv[i], "--output") && hasValue) {
+            outputPath = argv[++i];
+        } else if (!std::strcmp(argv[i], "--help") || !std::strcmp(argv[i], "-h")) {
+            std::fputs(kUsage, stdout);
+            return 0;
+        } else if (inputPath.empty()) {
+            inputPath = argv[i];
+        } else {
+            std::fputs(kUsage, stderr);
+            return 2;
+        }
+    }
+    if (inputPath.empty()) {
+        std::fputs(kUsage, stderr);
+        return 2;
+    }
+    // A node budget alone searches as deep as it allows
+    if (options.mLimits.mMaxDepth <= 0) {
+        options.mLimits.mMaxDepth = options.mLimits.mMaxNodes ? Search::kMaxDepth : kDefaultDepth;
+    }
+    // The table is cleared before every position, so small node budgets get a
+    // table they can fill rather than paying to wipe the default one each time
+    if (!hashGiven && options.mLimits.mMaxNodes) {
+        size_t megabytes = options.mLimits.mMaxNodes / (1024 * 1024 / kBytesPerNode) + 1;
+        options.mHashMegabytes = std::min(megabytes, kDefaultHashMegabytes);
+    }
+
+    std::ifstream file;
+    if (inputPath != "-") {
+        file.open(inputPath);
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", inputPath.c_str());
+            return 2;
+        }
+    }
+    std::FILE *output = stdout;
+    if (!outputPath.empty() && !(output = std::fopen(outputPath.c_str(), "w"))) {
+        std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+        return 2;
+    }
+
+    BatchRunner runner(options, output);
+    runner.run(inputPath == "-" ? std::cin : file);
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    return 0;
+}
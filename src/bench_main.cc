@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "evaluation.h"
+#include "move_list.h"
+#include "movegen.h"
+#include "perft.h"
+#include "position.h"
+#include "search.h"
+#include "transposition_table.h"
+
+#ifdef CHESS_BENCH_RENDER
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <memory>
+
+#include "board.h"
+#include "renderer.h"
+#endif
+
+static const char *kUsage =
+    "usage: chess-bench [options]   time the engine's hot paths over the perft positions\n"
+    "options:\n"
+    "       --filter <text>   only run benchmarks whose name contains the text\n"
+    "       --samples <n>     timed repetitions per benchmark (default 101)\n"
+    "       --depth <n>       depth of the search benchmark (default 6)\n"
+    "       --json            print the results as JSON, for diffing runs\n";
+
+static constexpr int kDefaultSamples = 101;
+static constexpr int kDefaultDepth = 6;
+// Searches take long enough that a few samples already give a stable median
+static constexpr int kSearchSamples = 5;
+static constexpr int64_t kWarmupNs = 200 * 1000 * 1000;
+// Passes over the position set per sample, so even the cheapest paths run
+// for far longer than the clock's resolution
+static constexpr int kInnerLoops = 1000;
+#ifdef CHESS_BENCH_RENDER
+static constexpr unsigned kFrameSize = 800;
+static constexpr int kRenderLoops = 20;
+#endif
+
+// Keeps the timed work observable so the compiler can't drop it
+static volatile uint64_t sSink;
+
+struct BenchResult {
+    std::string mName;
+    uint64_t mOps;  // operations per sample
+    int mSamples;
+    // Nanoseconds per operation
+    double mMedian;
+    double mP99;
+    double mMin;
+    double mMean;
+};
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Runs each benchmark until warm, then times it pSamples times. A benchmark
+// returns how many operations it performed, which must be the same every call.
+class BenchRunner {
+   public:
+    BenchRunner(const std::string &pFilter, int pSamples)
+        : mFilter(pFilter)
+        , mSamples(pSamples) {}
+
+    void run(const std::string &pName, int pSamples, const std::function<uint64_t()> &pBench);
+    const std::vector<BenchResult> &results() const { return mResults; }
+
+   private:
+    std::string mFilter;
+    int mSamples;
+    std::vector<BenchResult> mResults;
+};
+
+void BenchRunner::run(const std::string &pName, int pSamples,
+                      const std::function<uint64_t()> &pBench) {
+    if (pName.find(mFilter) == std::string::npos) {
+        return;
+    }
+    const int samples = std::min(pSamples, mSamples);
+    // Warm-up fills the caches and lets the clock frequency settle
+    uint64_t ops = 0;
+    for (int64_t start = nowNs(); nowNs() - start < kWarmupNs;) {
+        ops = pBench();
+    }
+
+    std::vector<double> times;
+    for (int i = 0; i < samples; i++) {
+        int64_t start = nowNs();
+        pBench();
+        times.push_back(static_cast<double>(nowNs() - start) / std::max<uint64_t>(ops, 1));
+    }
+    std::sort(times.begin(), times.end());
+    BenchResult result;
+    result.mName = pName;
+    result.mOps = ops;
+    result.mSamples = samples;
+    result.mMedian = times[times.size() / 2];
+    result.mP99 = times[static_cast<size_t>(std::ceil(times.size() * 0.99)) - 1];
+    result.mMin = times.front();
+    double total = 0;
+    for (double time : times) {
+        total += time;
+    }
+    result.mMean = total / times.size();
+    mResults.push_back(result);
+}
+
+static void printJson(const std::vector<BenchResult> &pResults, int pDepth, size_t pPositions) {
+    std::printf("{\"positions\":%zu,\"search_depth\":%d,\"unit\":\"ns/op\",\"benchmarks\":[",
+                pPositions, pDepth);
+    for (size_t i = 0; i < pResults.size(); i++) {
+        const BenchResult &result = pResults[i];
+        std::printf("%s\n  {\"name\":\"%s\",\"ops\":%llu,\"samples\":%d,\"median\":%.2f,"
+                    "\"p99\":%.2f,\"min\":%.2f,\"mean\":%.2f}",
+                    i ? "," : "", result.mName.c_str(),
+                    static_cast<unsigned long long>(result.mOps), result.mSamples,
+                    result.mMedian, result.mP99, result.mMin, result.mMean);
+    }
+    std::printf("\n]}\n");
+}
+
+static void printTable(const std::vector<BenchResult> &pResults) {
+    std::printf("%-22s %10s %8s %14s %14s %14s\n", "benchmark", "ops", "samples", "median ns/op",
+                "p99 ns/op", "min ns/op");
+    for (auto &result : pResults) {
+        std::printf("%-22s %10llu %8d %14.2f %14.2f %14.2f\n", result.mName.c_str(),
+                    static_cast<unsigned long long>(result.mOps), result.mSamples,
+                    result.mMedian, result.mP99, result.mMin);
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string filter;
+    int samples = kDefaultSamples, depth = kDefaultDepth;
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--filter") && hasValue) {
+            filter = argv[++i];
+        } else if (!std::strcmp(argv[i], "--samples") && hasValue) {
+            samples = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--depth") && hasValue) {
+            depth = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--json")) {
+            json = true;
+        } else {
+            std::fputs(kUsage, !std::strcmp(argv[i], "--help") ? stdout : stderr);
+            return !std::strcmp(argv[i], "--help") ? 0 : 2;
+        }
+    }
+
+    std::vector<Position> positions;
+    for (auto &test : perftSuite()) {
+        positions.emplace_back();
+        positions.back().setFromFen(test.mFen);
+    }
+
+    BenchRunner runner(filter, samples);
+    const std::pair<EPieceType, const char *> pieceTypes[] = {
+        {EPieceType::PAWN, "pawn"},   {EPieceType::KNIGHT, "knight"},
+        {EPieceType::BISHOP, "bishop"}, {EPieceType::ROOK, "rook"},
+        {EPieceType::QUEEN, "queen"}, {EPieceType::KING, "king"}};
+    for (auto &pieceType : pieceTypes) {
+        runner.run(std::string("movegen/") + pieceType.second, samples, [&] {
+            for (int loop = 0; loop < kInnerLoops; loop++) {
+                for (auto &position : positions) {
+                    MoveList moves;
+                    generateLegalPieceMoves(position, pieceType.first, moves);
+                    sSink += moves.size();
+                }
+            }
+            return static_cast<uint64_t>(kInnerLoops) * positions.size();
+        });
+    }
+    runner.run("movegen/legal", samples, [&] {
+        for (int loop = 0; loop < kInnerLoops; loop++) {
+            for (auto &position : positions) {
+                MoveList moves;
+                generateLegalMoves(position, moves);
+                sSink += moves.size();
+            }
+        }
+        return static_cast<uint64_t>(kInnerLoops) * positions.size();
+    });
+    runner.run("makemove/undo", samples, [&] {
+        uint64_t ops = 0;
+        for (int loop = 0; loop < kInnerLoops / 10; loop++) {
+            for (auto &position : positions) {
+                MoveList moves;
+                generateLegalMoves(position, moves);
+                for (auto &move : moves) {
+                    position.makeMove(move);
+                    sSink += position.key();
+                    position.undoMove();
+                }
+                ops += moves.size();
+            }
+        }
+        return ops;
+    });
+    runner.run("check/isInCheck", samples, [&] {
+        for (int loop = 0; loop < kInnerLoops; loop++) {
+            for (auto &position : positions) {
+                sSink += position.isInCheck(EPieceColor::WHITE);
+                sSink += position.isInCheck(EPieceColor::BLACK);
+            }
+        }
+        return static_cast<uint64_t>(kInnerLoops) * positions.size() * 2;
+    });
+    runner.run("eval/evaluate", samples, [&] {
+        for (int loop = 0; loop < kInnerLoops; loop++) {
+            for (auto &position : positions) {
+                sSink += evaluate(position);
+            }
+        }
+        return static_cast<uint64_t>(kInnerLoops) * positions.size();
+    });
+    TranspositionTable table;
+    runner.run("search/depth" + std::to_string(depth), kSearchSamples, [&] {
+        SearchLimits limits;
+        limits.mMaxDepth = depth;
+        for (auto &position : positions) {
+            // Every search starts cold, so samples don't speed each other up
+            table.clear();
+            Search search(table, 1);
+            sSink += search.run(position, limits).mNodes;
+        }
+        return static_cast<uint64_t>(positions.size());
+    });
+
+#ifdef CHESS_BENCH_RENDER
+    // One frame of the GUI board, drawn into a texture so no window is needed
+    sf::RenderTexture frame;
+    if (frame.create(kFrameSize, kFrameSize)) {
+        auto board = std::make_shared<Board>();
+        board->init();
+        board->loadPosition(positions.front());
+        runner.run("render/drawBoard", samples, [&] {
+            for (int loop = 0; loop < kRenderLoops; loop++) {
+                frame.clear(sf::Color::Black);
+                Renderer::drawSquares(frame, board);
+                frame.display();
+            }
+            return static_cast<uint64_t>(kRenderLoops);
+        });
+    } else {
+        std::fputs("no OpenGL context for an offscreen frame; render/drawBoard skipped\n",
+                   stderr);
+    }
+#endif
+
+    if (json) {
+        printJson(runner.results(), depth, positions.size());
+    } else {
+        printTable(runner.results());
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "bitboard.h"
+
+#include <vector>
+
+Bitboard AttackTables::mKnightAttacks[kSquareCount];
+Bitboard AttackTables::mKingAttacks[kSquareCount];
+Bitboard AttackTables::mPawnAttacks[kColorCount][kSquareCount];
+Magic AttackTables::mRookMagics[kSquareCount];
+Magic AttackTables::mBishopMagics[kSquareCount];
+Bitboard AttackTables::mRookTable[0x19000];
+Bitboard AttackTables::mBishopTable[0x1480];
+Bitboard AttackTables::mBetween[kSquareCount][kSquareCount];
+Bitboard AttackTables::mLine[kSquareCount][kSquareCount];
+
+static const int kRookDirections[4][2] = {
+    {0,  1 },
+    {0,  -1},
+    {1,  0 },
+    {-1, 0 }
+};
+static const int kBishopDirections[4][2] = {
+    {1,  1 },
+    {1,  -1},
+    {-1, 1 },
+    {-1, -1}
+};
+
+// Walks each ray until it leaves the board or hits a blocker (blocker included)
+static Bitboard slidingAttacks(int pSquare, Bitboard pOccupied, const int pDirections[4][2]) {
+    Bitboard attacks = 0;
+    for (int d = 0; d < 4; d++) {
+        int file = fileOf(pSquare) + pDirections[d][0];
+        int rank = rankOf(pSquare) + pDirections[d][1];
+        while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+            Bitboard bit = squareBit(makeSquare(file, rank));
+            attacks |= bit;
+            if (pOccupied & bit) {
+                break;
+            }
+            file += pDirections[d][0];
+            rank += pDirections[d][1];
+        }
+    }
+    return attacks;
+}
+
+// xorshift64* generator used to search for magic multipliers
+class MagicRng {
+   public:
+    explicit MagicRng(uint64_t pSeed)
+        : mState(pSeed) {}
+    uint64_t next() {
+        mState ^= mState >> 12;
+        mState ^= mState << 25;
+        mState ^= mState >> 27;
+        return mState * 2685821657736338717ULL;
+    }
+    // Magics with few set bits are found much faster
+    uint64_t sparse() { return next() & next() & next(); }
+
+   private:
+    uint64_t mState;
+};
+
+static Bitboard leaperAttacks(int pSquare, const int pOffsets[][2], int pCount) {
+    Bitboard attacks = 0;
+    for (int i = 0; i < pCount; i++) {
+        int file = fileOf(pSquare) + pOffsets[i][0];
+        int rank = rankOf(pSquare) + pOffsets[i][1];
+        if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+            attacks |= squareBit(makeSquare(file, rank));
+        }
+    }
+    return attacks;
+}
+
+void AttackTables::init() {
+    static const bool sInitialized = [] {
+        const int knightOffsets[8][2] = {
+            {-2, -1},
+            {-2, +1},
+            {+2, -1},
+            {+2, +1},
+            {+1, +2},
+            {-1, +2},
+            {+1, -2},
+            {-1, -2}
+        };
+        const int kingOffsets[8][2] = {
+            {0,  -1},
+            {0,  +1},
+            {-1, 0 },
+            {+1, 0 },
+            {-1, -1},
+            {-1, +1},
+            {+1, -1},
+            {+1, +1}
+        };
+        const int whitePawnOffsets[2][2] = {
+            {-1, +1},
+            {+1, +1}
+        };
+        const int blackPawnOffsets[2][2] = {
+            {-1, -1},
+            {+1, -1}
+        };
+
+        for (int sq = 0; sq < kSquareCount; sq++) {
+            mKnightAttacks[sq] = leaperAttacks(sq, knightOffsets, 8);
+            mKingAttacks[sq] = leaperAttacks(sq, kingOffsets, 8);
+            mPawnAttacks[static_cast<int>(EPieceColor::WHITE)][sq] =
+                leaperAttacks(sq, whitePawnOffsets, 2);
+            mPawnAttacks[static_cast<int>(EPieceColor::BLACK)][sq] =
+                leaperAttacks(sq, blackPawnOffsets, 2);
+        }
+        initMagics(mRookMagics, mRookTable, kRookDirections);
+        initMagics(mBishopMagics, mBishopTable, kBishopDirections);
+
+        for (int from = 0; from < kSquareCount; from++) {
+            for (int to = 0; to < kSquareCount; to++) {
+                Bitboard ends = squareBit(from) | squareBit(to);
+                if (rookAttacks(from, 0) & squareBit(to)) {
+                    mLine[from][to] = (rookAttacks(from, 0) & rookAttacks(to, 0)) | ends;
+                    mBetween[from][to] =
+                        rookAttacks(from, squareBit(to)) & rookAttacks(to, squareBit(from));
+                } else if (bishopAttacks(from, 0) & squareBit(to)) {
+                    mLine[from][to] = (bishopAttacks(from, 0) & bishopAttacks(to, 0)) | ends;
+                    mBetween[from][to] =
+                        bishopAttacks(from, squareBit(to)) & bishopAttacks(to, squareBit(from));
+                }
+            }
+        }
+        return true;
+    }();
+    (void)sInitialized;
+}
+
+void AttackTables::initMagics(Magic pMagics[], Bitboard pTable[], const int pDirections[4][2]) {
+    std::vector<Bitboard> occupancies(4096);
+    std::vector<Bitboard> reference(4096);
+#ifndef USE_PEXT
+    // Fixed seeds keep start-up time short and deterministic
+    const uint64_t seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+    std::vector<int> epoch(4096, 0);
+    int attempt = 0;
+#endif
+
+    Bitboard *attacks = pTable;
+    for (int sq = 0; sq < kSquareCount; sq++) {
+        // Edge squares never block a ray further, so they are left out of the mask
+        Bitboard edges = ((kRank1 | kRank8) & ~(kRank1 << (8 * rankOf(sq)))) |
+                         ((kFileA | kFileH) & ~(kFileA << fileOf(sq)));
+        Magic &magic = pMagics[sq];
+        magic.mMask = slidingAttacks(sq, 0, pDirections) & ~edges;
+        magic.mShift = 64 - popCount(magic.mMask);
+        magic.mAttacks = attacks;
+
+        // Carry-Rippler walk over every subset of the mask
+        int size = 0;
+        Bitboard subset = 0;
+        do {
+            occupancies[size] = subset;
+            reference[size] = slidingAttacks(sq, subset, pDirections);
+#ifdef USE_PEXT
+            magic.mAttacks[magic.index(subset)] = reference[size];
+#endif
+            size++;
+            subset = (subset - magic.mMask) & magic.mMask;
+        } while (subset);
+        attacks += size;
+
+#ifndef USE_PEXT
+        MagicRng rng(seeds[rankOf(sq)]);
+        for (int i = 0; i < size;) {
+            do {
+                magic.mMagic = rng.sparse();
+            } while (popCount((magic.mMask * magic.mMagic) >> 56) < 6);
+
+            // A candidate is accepted once no two subsets with different attacks collide
+            attempt++;
+            for (i = 0; i < size; i++) {
+                unsigned index = magic.index(occupancies[i]);
+                if (epoch[index] < attempt) {
+                    epoch[index] = attempt;
+                    magic.mAttacks[index] = reference[i];
+                } else if (magic.mAttacks[index] != reference[i]) {
+                    break;
+                }
+            }
+        }
+#endif
+    }
+}
@@ -2,9 +2,12 @@
 
 #include <SFML/System/Vector2.hpp>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "bitboard.h"
 #include "piece.h"
+#include "position.h"
 #include "square.h"
 
 void Board::placePiece(int pX, int pY, EPieceType pType, EPieceColor pColor) {
@@ -29,38 +32,16 @@ bool Board::init() {
 
         mSquares.push_back(row);
     }
-    // Initial Pieces Positions
-    // PAWNS
-    for (int i = 0; i < 8; i++) {
-        placePiece(i, 1, EPieceType::PAWN, EPieceColor::BLACK);
-        placePiece(i, 6, EPieceType::PAWN, EPieceColor::WHITE);
+    // The starting pieces come from a FEN record like any other position
+    return loadFen(kStartFen);
+}
+
+bool Board::loadFen(const std::string &pFen) {
+    Position position;
+    if (!position.setFromFen(pFen)) {
+        return false;
     }
-    // White Bishops
-    placePiece(2, 0, EPieceType::BISHOP, EPieceColor::BLACK);
-    placePiece(5, 0, EPieceType::BISHOP, EPieceColor::BLACK);
-    // Black Bishops
-    placePiece(2, 7, EPieceType::BISHOP, EPieceColor::WHITE);
-    placePiece(5, 7, EPieceType::BISHOP, EPieceColor::WHITE);
-    // White Rooks
-    placePiece(0, 7, EPieceType::ROOK, EPieceColor::WHITE);
-    placePiece(7, 7, EPieceType::ROOK, EPieceColor::WHITE);
-    // Black Rooks
-    placePiece(0, 0, EPieceType::ROOK, EPieceColor::BLACK);
-    placePiece(7, 0, EPieceType::ROOK, EPieceColor::BLACK);
-    // White Knights
-    placePiece(1, 7, EPieceType::KNIGHT, EPieceColor::WHITE);
-    placePiece(6, 7, EPieceType::KNIGHT, EPieceColor::WHITE);
-    // Black Knights
-    placePiece(1, 0, EPieceType::KNIGHT, EPieceColor::BLACK);
-    placePiece(6, 0, EPieceType::KNIGHT, EPieceColor::BLACK);
-    // White King
-    placePiece(4, 7, EPieceType::KING, EPieceColor::WHITE);
-    // Black King
-    placePiece(4, 0, EPieceType::KING, EPieceColor::BLACK);
-    // White Queen
-    placePiece(3, 7, EPieceType::QUEEN, EPieceColor::WHITE);
-    // Black Queen
-    placePiece(3, 0, EPieceType::QUEEN, EPieceColor::BLACK);
+    loadPosition(position);
     return true;
 }
 
@@ -79,4 +60,49 @@ Square::SquarePtr Board::squareAt(sf::Vector2i pSquarePosition) {
         return nullptr;
     }
     return mSquares[pSquarePosition.x][pSquarePosition.y];
-}
\ No newline at end of file
+}
+Square::SquarePtr Board::squareAtIndex(int pSquareIndex) {
+    return mSquares[fileOf(pSquareIndex)][7 - rankOf(pSquareIndex)];
+}
+
+void Board::loadPosition(const Position &pPosition) {
+    for (auto &row : mSquares) {
+        for (auto &square : row) {
+            square->clear();
+        }
+    }
+    mPieces.clear();
+
+    const int rights = pPosition.castlingRights();
+    for (int sq = 0; sq < kSquareCount; sq++) {
+        PieceCode code = pPosition.pieceAt(sq);
+        if (code == kNoPiece) {
+            continue;
+        }
+        EPieceColor color = pieceColor(code);
+        EPieceType type = pieceType(code);
+        placePiece(fileOf(sq), 7 - rankOf(sq), type, color);
+
+        // Derive the GUI "moved" flag from the position's irreversible state
+        bool white = color == EPieceColor::WHITE;
+        bool movedBefore = false;
+        switch (type) {
+            case EPieceType::PAWN: movedBefore = rankOf(sq) != (white ? 1 : 6); break;
+            case EPieceType::KING:
+                movedBefore = !(rights & (white ? kWhiteKingSide | kWhiteQueenSide
+                                                : kBlackKingSide | kBlackQueenSide));
+                break;
+            case EPieceType::ROOK:
+                if (sq == (white ? 7 : 63)) {
+                    movedBefore = !(rights & (white ? kWhiteKingSide : kBlackKingSide));
+                } else if (sq == (white ? 0 : 56)) {
+                    movedBefore = !(rights & (white ? kWhiteQueenSide : kBlackQueenSide));
+                } else {
+                    movedBefore = true;
+                }
+                break;
+            default: break;
+        }
+        mPieces.back()->mMovedBefore = movedBefore;
+    }
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "opening_book.h"
+#include "pgn.h"
+#include "position.h"
+
+static const char *kUsage =
+    "usage: chess-book [options] <games.pgn> <book.bin>   build an opening book from PGN games\n"
+    "options:\n"
+    "       --plies <n>       book moves up to this ply of each game (default 20)\n"
+    "       --min-games <n>   drop moves played in fewer games (default 2)\n"
+    "       --threads <n>     parse the games in parallel (default: all cores)\n";
+
+static constexpr int kDefaultPlies = 20;
+static constexpr int kDefaultMinGames = 2;
+
+// How often a move was played in a position and the half-points it scored
+struct MoveStats {
+    uint32_t mGames = 0;
+    uint32_t mHalfPoints = 0;
+};
+
+int main(int argc, char **argv) {
+    int plies = kDefaultPlies, minGames = kDefaultMinGames;
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--plies") && hasValue) {
+            plies = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--min-games") && hasValue) {
+            minGames = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--threads") && hasValue) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--help") || !std::strcmp(argv[i], "-h")) {
+            std::fputs(kUsage, stdout);
+            return 0;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        std::fputs(kUsage, stderr);
+        return 2;
+    }
+
+    MappedFile file;
+    if (!file.open(paths[0])) {
+        std::fprintf(stderr, "cannot open %s\n", paths[0].c_str());
+        return 2;
+    }
+
+    std::mutex statsMutex;
+    std::map<std::pair<uint64_t, uint16_t>, MoveStats> stats;
+    size_t used = 0;
+    forEachPgnGame(file.text(), threads, [&](const PgnGameView &pGame) {
+        // Half-points White scored; unfinished games say nothing about the moves
+        int whiteHalfPoints;
+        if (pGame.mResult == "1-0") {
+            whiteHalfPoints = 2;
+        } else if (pGame.mResult == "0-1") {
+            whiteHalfPoints = 0;
+        } else if (pGame.mResult == "1/2-1/2") {
+            whiteHalfPoints = 1;
+        } else {
+            return;
+        }
+        thread_local Position position;
+        // Weights hold the half-points of the side that played the move
+        thread_local std::vector<BookRecord> played;
+        played.clear();
+        std::string_view fen = pGame.tag("FEN");
+        if (fen.empty()) {
+            position.setStartPosition();
+        } else if (!position.setFromFen(std::string(fen))) {
+            return;
+        }
+        for (auto san : pGame.mMoves) {
+            PositionMove move = parseSanMove(position, san);
+            if (static_cast<int>(played.size()) == plies || move.isNull()) {
+                break;
+            }
+            const bool white = position.sideToMove() == EPieceColor::WHITE;
+            played.push_back({polyglotKey(position), encodeBookMove(move),
+                              static_cast<uint16_t>(white ? whiteHalfPoints : 2 - whiteHalfPoints),
+                              0});
+            position.makeMove(move);
+        }
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        for (auto &record : played) {
+            MoveStats &entry = stats[{record.mKey, record.mMove}];
+            entry.mGames++;
+            entry.mHalfPoints += record.mWeight;
+        }
+        used++;
+    });
+
+    // Polyglot's own books weigh a move by the half-points it scored; weights
+    // are scaled down together if the most played move overflows 16 bits
+    uint32_t maxWeight = 0;
+    for (auto &entry : stats) {
+        if (entry.second.mGames >= static_cast<uint32_t>(minGames)) {
+            maxWeight = std::max(maxWeight, entry.second.mHalfPoints);
+        }
+    }
+    const double scale = maxWeight > UINT16_MAX ? static_cast<double>(UINT16_MAX) / maxWeight : 1.0;
+    std::vector<BookRecord> records;
+    for (auto &entry : stats) {
+        uint32_t weight = static_cast<uint32_t>(entry.second.mHalfPoints * scale);
+        if (entry.second.mGames >= static_cast<uint32_t>(minGames) && weight > 0) {
+            records.push_back({entry.first.first, entry.first.second,
+                               static_cast<uint16_t>(weight), 0});
+        }
+    }
+    if (!writeBook(paths[1], records)) {
+        std::fprintf(stderr, "cannot write %s\n", paths[1].c_str());
+        return 2;
+    }
+    std::printf("games %zu  entries %zu\n", used, records.size());
+    return 0;
+}
@@ -8,23 +8,35 @@
 #include <SFML/Window/VideoMode.hpp>
 #include <algorithm>
 #include <cstdio>
+#include <ctime>
+#include <fstream>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <ostream>
 #include <random>
-#include <stack>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "bitboard.h"
 #include "board.h"
 #include "common.h"
+#include "evaluation.h"
 #include "imgui.h"
 #include "input_handler.h"
+#include "mapped_file.h"
+#include "move_list.h"
+#include "movegen.h"
+#include "pgn.h"
 #include "piece.h"
+#include "position.h"
 #include "renderer.h"
+#include "search.h"
 #include "square.h"
+#include "tablebase.h"
+#include "transposition_table.h"
 
 static Piece::PiecePtr sSelectedPiece = nullptr;
 static bool sRulesDisabled = true;
@@ -33,6 +45,16 @@ static bool sPieceInfoShown = false;
 static bool sMoveGeneration = false;
 static bool sAiMoveGeneration = false;
 static bool sAnimationEnabled = false;
+static int sThinkTimeMs = 1000;
+static int sSearchThreads = 1;
+static SearchOptions sSearchOptions;
+static char sFenBuffer[128] = "";
+static char sPgnPathBuffer[256] = "game.pgn";
+static bool sUseBook = true;
+static char sBookPathBuffer[256] = "";
+static char sTablebasePathBuffer[256] = "";
+static bool sLogSearchStats = false;
+static char sStatsLogPathBuffer[256] = "search_stats.jsonl";
 
 bool isRulesDisabled() {
 #ifdef IMGUI_MODE
@@ -86,9 +108,16 @@ Engine::Engine()
     : mInputDispatcher(mRenderer.getWindow())
     , mAnimationEngine(mRenderer)
     , mBoard(std::make_shared<Board>())
+    , mSearchJob(mTranspositionTable)
     , mGameMode(GameMode::SINGLE)
     , rng(rd()) {
     mBoard->init();
+    mPosition.setStartPosition();
+    // The book is optional; without one every move is searched
+    mBook.open(kDefaultBookPath);
+    std::snprintf(sBookPathBuffer, sizeof(sBookPathBuffer), "%s", kDefaultBookPath);
+    Tablebases::init(kDefaultTablebasePath);
+    std::snprintf(sTablebasePathBuffer, sizeof(sTablebasePathBuffer), "%s", kDefaultTablebasePath);
     Player *wPlayer = new Player(EPieceColor::WHITE);
     Player *bPlayer = new Player(EPieceColor::BLACK);
     wPlayer->mNext = bPlayer;
@@ -104,26 +133,98 @@ const sf::Color GREEN_SQUARE(118, 150, 86);
 Square::SquarePtr Engine::mSelectedSquare = nullptr;
 
 void Engine::resetEngine() {
+    cancelBestMove();
     mBoard = std::make_shared<Board>();
     mBoard->init();
+    mPosition.setStartPosition();
+    mMoveHistory.clear();
+    mStartFen = kStartFen;
     if (mCurrentPlayer->mPlayerColor != EPieceColor::WHITE) {
         mCurrentPlayer = mCurrentPlayer->mNext;
     }
 }
 
+bool Engine::loadFen(const std::string &pFen) {
+    Position position;
+    if (!position.setFromFen(pFen)) {
+        return false;
+    }
+    cancelBestMove();
+    deselectSquare();
+    mPosition = position;
+    mBoard->loadPosition(mPosition);
+    mMoveHistory.clear();
+    mStartFen = mPosition.toFen();
+    if (mCurrentPlayer->mPlayerColor != mPosition.sideToMove()) {
+        mCurrentPlayer = mCurrentPlayer->mNext;
+    }
+    mRenderer.mDrawFlag = true;
+    return true;
+}
+
+std::string Engine::fen() const { return mPosition.toFen(); }
+
+bool Engine::savePgn(const std::string &pPath) const {
+    PgnGame game;
+    game.mStartFen = mStartFen;
+    for (auto &record : mMoveHistory) {
+        game.mMoves.push_back(record.mMove);
+    }
+    MoveList moves;
+    generateLegalMoves(mPosition, moves);
+    if (moves.empty()) {
+        const bool whiteMated = mPosition.sideToMove() == EPieceColor::WHITE;
+        game.mResult = !mPosition.checkers() ? "1/2-1/2" : whiteMated ? "0-1" : "1-0";
+    }
+    char date[16];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y.%m.%d", std::localtime(&now));
+    game.mTags = {{"Event", "ChessEngine game"}, {"Date", date}};
+
+    std::ofstream file(pPath, std::ios::binary);
+    file << writePgn(game);
+    return static_cast<bool>(file);
+}
+
+bool Engine::loadPgn(const std::string &pPath) {
+    MappedFile file;
+    PgnGame game;
+    if (!file.open(pPath) || !readPgn(file.text(), game) || !loadFen(game.mStartFen)) {
+        return false;
+    }
+    for (auto &move : game.mMoves) {
+        makeMove(move);
+    }
+    if (mCurrentPlayer->mPlayerColor != mPosition.sideToMove()) {
+        mCurrentPlayer = mCurrentPlayer->mNext;
+    }
+    return true;
+}
+
+void Engine::cancelBestMove() {
+    if (!mSearchJob.isRunning()) {
+        return;
+    }
+    mSearchJob.cancel();
+    mInputDispatcher.enableLocalInput();
+}
+
 void Engine::switchPlayers() {
+    cancelBestMove();
     auto king = findKing(mCurrentPlayer->mPlayerColor);
-    king->mSquare->deSelect();
+    if (king) {
+        king->mSquare->deSelect();
+    }
     mCurrentPlayer = mCurrentPlayer->mNext;
+    if (mPosition.sideToMove() != mCurrentPlayer->mPlayerColor) {
+        syncPositionFromBoard();
+    }
     mInputDispatcher.enableLocalInput();
     checkForCheckmate();
     if (mCurrentPlayer->mPlayerColor == EPieceColor::BLACK &&
         (mGameMode == GameMode::SINGLE || mGameMode == GameMode::ONLINE) &&
         isAiMoveGenerationEnabled()) {
-        mInputDispatcher.disableLocalInput();
         makeBestMove();
-        mInputDispatcher.enableLocalInput();
-        mCurrentPlayer = mCurrentPlayer->mNext;
         return;
     }
 }
@@ -170,14 +271,8 @@ void Engine::switchSelection(Square::SquarePtr pCurrentSquare) {
 }
 
 bool Engine::isLegalMove(Piece::PiecePtr pOccupier, Square::SquarePtr pTargetSquare) {
-    if (mLegalMoves.empty()) {
-        return false;
-    }
-    if (mLegalMoves.count(pTargetSquare)) {
-        return true;
-    }
-
-    return false;
+    auto targets = generatePossibleMoves(pOccupier);
+    return std::find(targets.begin(), targets.end(), pTargetSquare) != targets.end();
 }
 
 void Engine::movePiece(Piece::PiecePtr pOccupier, Square::SquarePtr pTargetSquare) {
@@ -185,70 +280,44 @@ void Engine::movePiece(Piece::PiecePtr pOccupier, Square::SquarePtr pTargetSquar
         deselectSquare();
         return;
     }
-    auto startPos = mSelectedSquare->getPostion();
-    auto targetPos = pTargetSquare->getPostion();
-    bool isInCheck = isPlayerInCheck(mCurrentPlayer->mPlayerColor);
-    Move move(pOccupier, nullptr, pOccupier->mSquare, pTargetSquare);
-    if (mMoveHistory.empty()) {
-        move = Move(pOccupier, nullptr, pOccupier->mSquare, pTargetSquare);
-    } else if (mMoveHistory.top().mOpponent == nullptr) {
-        move = Move(pOccupier, nullptr, pOccupier->mSquare, pTargetSquare);
-    }
-    if (pOccupier->mType != EPieceType::KING) {
-        if (wouldExposeKing(move)) {
-            deselectSquare();
-            auto king = findKing(mCurrentPlayer->mPlayerColor);
-            king->mSquare->select();
-            return;
+    PositionMove move;
+    if (!findPositionMove(pOccupier->mSquare, pTargetSquare, move)) {
+        // Free placement while rules are disabled: edit the board and resync the position
+        auto startPos = mSelectedSquare->getPostion();
+        auto targetPos = pTargetSquare->getPostion();
+        auto captured = pTargetSquare->getOccupier();
+        MoveRecord record;
+        record.mMove = PositionMove(pOccupier->mSquare->getIndex(), pTargetSquare->getIndex(),
+                                    captured ? EMoveFlag::CAPTURE : EMoveFlag::QUIET);
+        record.mPiece = makePiece(pOccupier->getColor(), pOccupier->getType());
+        if (captured) {
+            record.mCaptured = makePiece(captured->getColor(), captured->getType());
         }
+        mMoveHistory.push_back(record);
+        mSelectedSquare->clear();
+        pTargetSquare->clear();
+        pOccupier->setSquare(pTargetSquare);
+        pOccupier->mMovedBefore = true;
+        if (isAnimationEnabled()) {
+            mAnimationEngine.animateMovement(pOccupier, startPos, targetPos);
+        }
+        pTargetSquare->setOccupier(pOccupier);
+        syncPositionFromBoard();
+        deselectSquare();
+        switchPlayers();
+        return;
     }
-    mMoveHistory.push(move);
     if (pOccupier->mType == EPieceType::KING) {
         pOccupier->mSquare->deSelect();
     }
-    mSelectedSquare->clear();
-    pOccupier->setSquare(pTargetSquare);
-    pOccupier->mMovedBefore = true;
-    if (isAnimationEnabled()) {
-        mAnimationEngine.animateMovement(pOccupier, startPos, targetPos);
-    }
-    pTargetSquare->setOccupier(pOccupier);
+    animateMove(move);
+    makeMove(move);
     deselectSquare();
     switchPlayers();
 }
 
 void Engine::capturePiece(Piece::PiecePtr pOccupier, Square::SquarePtr pTargetSquare) {
-    if (!isLegalMove(pOccupier, pTargetSquare) && !isRulesDisabled()) {
-        deselectSquare();
-        return;
-    }
-    Square::SquarePtr tempTargetSquare = pTargetSquare;
-    bool isEnPassantMove = false;
-    if (pOccupier->mType == EPieceType::PAWN) {
-        Square::SquarePtr enPassant = Engine::isEnPassant(pOccupier);
-        if (pTargetSquare == enPassant) {
-            isEnPassantMove = true;
-            int x = pTargetSquare->getX();
-            int y = pTargetSquare->getY();
-            int v;
-            if (pOccupier->mColor == EPieceColor::WHITE) {
-                v = -1;
-            } else {
-                v = 1;
-            }
-            pTargetSquare = pTargetSquare->mBoard->squareAt({x, y + v});
-            mLegalMoves.insert(pTargetSquare);
-        }
-    }
-    auto opponent = tempTargetSquare->getOccupier();
-    Move move(pOccupier, opponent, pOccupier->mSquare, pTargetSquare);
-    if (isEnPassantMove) {
-        move.mMoveType = MoveType::EN_PASSANT;
-    }
-    mMoveHistory.push(move);
-    tempTargetSquare->clear();
     movePiece(pOccupier, pTargetSquare);
-    opponent->deOccupy();
 }
 
 void Engine::proccessMove(Square::SquarePtr pCurrentSquare) {
@@ -290,227 +359,23 @@ void Engine::handleInput() {
 }
 
 std::vector<Square::SquarePtr> Engine::generatePossibleMoves(Piece::PiecePtr pPiece) {
-    EPieceType selectedPieceType = pPiece->getType();
-    switch (selectedPieceType) {
-        case EPieceType::KING: return generateKingMoves(pPiece);
-        case EPieceType::PAWN: return generatePawnMoves(pPiece);
-        case EPieceType::ROOK: return generateRookMoves(pPiece);
-        case EPieceType::BISHOP: return generateBishopMoves(pPiece);
-        case EPieceType::QUEEN: return generateQueenMoves(pPiece);
-        case EPieceType::KNIGHT: return generateKnightMoves(pPiece);
-    }
-}
-
-std::vector<Square::SquarePtr> Engine::generatePawnMoves(Piece::PiecePtr pPiece) {
-    std::vector<Square::SquarePtr> moves;
-    sf::Vector2f position = pPiece->mSquare->getPostion();
-    EPieceColor pieceColor = pPiece->getColor();
-
-    int forward = (pieceColor == EPieceColor::WHITE) ? -1 : 1;
-    int startRow = (pieceColor == EPieceColor::WHITE) ? 6 : 1;
-
-    // Single forward move
-    sf::Vector2i forwardMove(position.x, position.y + forward);
-    if (forwardMove.y >= 0 && forwardMove.y < 8) {
-        Square::SquarePtr forwardSquare = pPiece->mSquare->mBoard->squareAt(forwardMove);
-        if (!forwardSquare->isOccupied()) {
-            moves.push_back(forwardSquare);
-
-            // Double forward move
-            if (!pPiece->mMovedBefore) {
-                sf::Vector2i doubleForwardMove(position.x, position.y + 2 * forward);
-                Square::SquarePtr doubleForwardSquare =
-                    pPiece->mSquare->mBoard->squareAt(doubleForwardMove);
-                if (doubleForwardSquare && !doubleForwardSquare->isOccupied()) {
-                    moves.push_back(doubleForwardSquare);
-                }
-            }
-        }
-    }
-
-    // Diagonal captures
-    for (int dx : {-1, 1}) {
-        sf::Vector2i diagonalMove(position.x + dx, position.y + forward);
-        if (diagonalMove.x >= 0 && diagonalMove.x < 8 && diagonalMove.y >= 0 &&
-            diagonalMove.y < 8) {
-            Square::SquarePtr diagonalSquare = pPiece->mSquare->mBoard->squareAt(diagonalMove);
-            if (diagonalSquare->isOccupied() &&
-                diagonalSquare->getOccupier()->getColor() != pieceColor) {
-                moves.push_back(diagonalSquare);
-            }
-        }
-    }
-
-    Square::SquarePtr enPassant = Engine::isEnPassant(pPiece);
-    if (enPassant) {
-        moves.push_back(enPassant);
-    }
-    return moves;
-}
-
-Square::SquarePtr Engine::isEnPassant(Piece::PiecePtr pPawn) {
-    sf::Vector2f pos = pPawn->mSquare->getPostion();
-    EPieceColor pawnColor = pPawn->getColor();
-
-    int enPassantRank = (pawnColor == EPieceColor::WHITE) ? 3 : 4;
-    if (pPawn->mSquare->getY() != enPassantRank) {
-        return nullptr;
-    }
-
-    Square::SquarePtr adjLeft = mBoard->squareAt({int(pos.x - 1), int(pos.y)});
-    Square::SquarePtr adjRight = mBoard->squareAt({int(pos.x + 1), int(pos.y)});
-    if ((!adjLeft || !adjLeft->isOccupied()) && (!adjRight || !adjRight->isOccupied())) {
-        return nullptr;
-    }
-    if (mMoveHistory.empty()) {
-        return nullptr;
-    }
-
-    Move lastMove = mMoveHistory.top();
-    if (lastMove.mOccupier->mType != EPieceType::PAWN) {
-        return nullptr;
-    }
-
-    int nSquares = std::abs(lastMove.mFrom->getY() - lastMove.mTo->getY());
-    if (nSquares != 2) {
-        return nullptr;
-    }
-
-    if (adjLeft && lastMove.mTo == adjLeft) {
-        return adjLeft;
-    }
-    if (adjRight && lastMove.mTo == adjRight) {
-        return adjRight;
-    }
-
-    return nullptr;
-}
-
-std::vector<Square::SquarePtr> Engine::generateUsingCoords(
-    Piece::PiecePtr pPiece, const std::vector<std::pair<int, int>> &pCoords) {
-    std::vector<Square::SquarePtr> moves;
-    sf::Vector2f position = pPiece->mSquare->getPostion();
-    EPieceColor color = pPiece->mSquare->getOccupier()->getColor();
-
-    // Iterate over the direction pairs
-    for (auto &[x, y] : pCoords) {
-        sf::Vector2i newPosition(position.x, position.y);
-
-        // Continue moving in the direction while within bounds
-        while (true) {
-            newPosition.x += x;
-            newPosition.y += y;
-
-            // Check for board boundaries
-            if (newPosition.x < 0 || newPosition.x >= 8 || newPosition.y < 0 ||
-                newPosition.y >= 8) {
-                break;
-            }
-
-            Square::SquarePtr adjacentSquare = pPiece->mSquare->mBoard->squareAt(newPosition);
-
-            // If square is occupied
-            if (adjacentSquare->isOccupied()) {
-                // If the occupier is the same color, stop
-                if (adjacentSquare->getOccupier()->getColor() == color) {
-                    break;
-                }
-                // If the occupier is of the opposite color, this is a valid move
-                moves.push_back(adjacentSquare);
-                break;  // No further moves in this direction
-            }
-
-            // If square is empty, it's a valid move
-            moves.push_back(adjacentSquare);
+    // The targets come from the engine's legal moves, so the human plays by the
+    // same rules as the search: castling, en passant and pins included
+    std::vector<Square::SquarePtr> targets;
+    if (!pPiece->mSquare || pPiece->getColor() != mPosition.sideToMove()) {
+        return targets;
+    }
+    MoveList moves;
+    generateLegalMoves(mPosition, moves);
+    for (auto &move : moves) {
+        auto target = mBoard->squareAtIndex(move.to());
+        // The four promotions of a pawn share one target square
+        if (move.from() == pPiece->mSquare->getIndex() &&
+            std::find(targets.begin(), targets.end(), target) == targets.end()) {
+            targets.push_back(target);
         }
     }
-    return moves;
-}
-
-std::vector<Square::SquarePtr> Engine::generateRookMoves(Piece::PiecePtr pPiece) {
-    std::vector<std::pair<int, int>> coords{
-        {0,  -1}, // Move up
-        {0,  +1}, // Move down
-        {+1, 0 }, // Move right
-        {-1, 0 }  // Move left
-    };
-
-    return generateUsingCoords(pPiece, coords);
-}
-
-std::vector<Square::SquarePtr> Engine::generateBishopMoves(Piece::PiecePtr pPiece) {
-    std::vector<std::pair<int, int>> coords{
-        {+1, -1}, // Move diagonally up-left
-        {-1, -1}, // Move diagonally up-right
-        {+1, +1}, // Move diagonally down-left
-        {-1, +1}  // Move diagonally down-right
-    };
-
-    return generateUsingCoords(pPiece, coords);
-}
-
-std::vector<Square::SquarePtr> Engine::generateQueenMoves(Piece::PiecePtr pPiece) {
-    std::vector<Square::SquarePtr> moves;
-
-    auto b = generateBishopMoves(pPiece);
-    auto r = generateRookMoves(pPiece);
-    moves.insert(moves.end(), b.begin(), b.end());
-    moves.insert(moves.end(), r.begin(), r.end());
-
-    return moves;
-}
-
-std::vector<Square::SquarePtr> Engine::generateMovesForPiece(
-    Piece::PiecePtr pPiece, const std::vector<sf::Vector2i> &directions) {
-    std::vector<Square::SquarePtr> moves;
-    sf::Vector2f position = pPiece->mSquare->getPostion();
-    EPieceColor color = pPiece->getColor();
-
-    for (const auto &dir : directions) {
-        sf::Vector2i newPosition(position.x + dir.x, position.y + dir.y);
-
-        // Check if within bounds
-        if (newPosition.x >= 0 && newPosition.x < 8 && newPosition.y >= 0 && newPosition.y < 8) {
-            Square::SquarePtr adjacent = pPiece->mSquare->mBoard->squareAt(newPosition);
-
-            // If square is unoccupied or occupied by the opponent's piece, add to legal moves
-            if (!adjacent->isOccupied() || adjacent->getOccupier()->getColor() != color) {
-                moves.push_back(adjacent);
-            }
-        }
-    }
-    return moves;
-}
-
-std::vector<Square::SquarePtr> Engine::generateKingMoves(Piece::PiecePtr pPiece) {
-    std::vector<sf::Vector2i> coords{
-        {0,  -1},
-        {0,  +1},
-        {-1, 0 },
-        {+1, 0 },
-        {-1, -1},
-        {-1, +1},
-        {+1, -1},
-        {+1, +1}
-    };
-
-    return generateMovesForPiece(pPiece, coords);
-}
-
-// Generate Knight moves (L-shaped movement)
-std::vector<Square::SquarePtr> Engine::generateKnightMoves(Piece::PiecePtr pPiece) {
-    std::vector<sf::Vector2i> coords{
-        {-2, -1},
-        {-2, +1},
-        {+2, -1},
-        {+2, +1},
-        {+1, +2},
-        {-1, +2},
-        {+1, -2},
-        {-1, -2}
-    };
-
-    return generateMovesForPiece(pPiece, coords);
+    return targets;
 }
 
 void Engine::clearHighlights() {
@@ -527,6 +392,44 @@ void Engine::highlightSquares() {
 }
 
 #ifdef IMGUI_MODE
+static void showSearchStats(const SearchStats &pStats, uint64_t pNodes, int64_t pTimeMs) {
+    auto percent = [](uint64_t pPart, uint64_t pWhole) {
+        return pWhole ? 100.0 * pPart / pWhole : 0.0;
+    };
+    ImGui::Text("Nodes: %llu, qnodes %llu, %llu nps", static_cast<unsigned long long>(pNodes),
+                static_cast<unsigned long long>(pStats.mQuiescenceNodes),
+                static_cast<unsigned long long>(nodesPerSecond(pNodes, pTimeMs)));
+    ImGui::Text("Branching factor: %.2f", pStats.effectiveBranchingFactor());
+    ImGui::Text("TT: %llu probes, %.1f%% hits, %.1f%% cutoffs",
+                static_cast<unsigned long long>(pStats.mTableProbes),
+                percent(pStats.mTableHits, pStats.mTableProbes),
+                percent(pStats.mTableCutoffs, pStats.mTableProbes));
+    ImGui::Text("First move cutoffs: %.1f%%", 100.0 * pStats.firstMoveCutoffRate());
+    ImGui::Text("Rejected hash moves: %llu, delta prunes %llu, SEE prunes %llu",
+                static_cast<unsigned long long>(pStats.mHashMoveRejects),
+                static_cast<unsigned long long>(pStats.mDeltaPrunes),
+                static_cast<unsigned long long>(pStats.mSeePrunes));
+    if (ImGui::TreeNode("Cutoffs by Move")) {
+        for (int i = 0; i < SearchStats::kCutoffBuckets; i++) {
+            ImGui::Text("%d%s: %.1f%%", i + 1, i + 1 == SearchStats::kCutoffBuckets ? "+" : "",
+                        percent(pStats.mCutoffs[i], pStats.cutoffs()));
+        }
+        ImGui::TreePop();
+    }
+    if (ImGui::TreeNode("Iterations")) {
+        uint64_t previousNodes = 0;
+        int64_t previousTimeMs = 0;
+        for (auto &iteration : pStats.mIterations) {
+            ImGui::Text("depth %2d: %llu nodes, %lld ms", iteration.mDepth,
+                        static_cast<unsigned long long>(iteration.mNodes - previousNodes),
+                        static_cast<long long>(iteration.mTimeMs - previousTimeMs));
+            previousNodes = iteration.mNodes;
+            previousTimeMs = iteration.mTimeMs;
+        }
+        ImGui::TreePop();
+    }
+}
+
 void Engine::handleImGui() {
     // ImGui::SFML::Update(mRenderer.getWindow(), mRenderer.getClock().restart());
     int flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_BordersV |
@@ -549,7 +452,74 @@ void Engine::handleImGui() {
     ImGui::Checkbox("Enable Move Generation", &sMoveGeneration);
     ImGui::Checkbox("Enable AI", &sAiMoveGeneration);
     ImGui::Checkbox("Enable Animation", &sAnimationEnabled);
-    if (ImGui::Button("Undo Last Move")) {
+    ImGui::SliderInt("Think Time (ms)", &sThinkTimeMs, 50, 10000);
+    int hashMegabytes = static_cast<int>(mTranspositionTable.sizeInMegabytes());
+    // The table can't be reallocated under a running search
+    if (ImGui::InputInt("Hash (MB)", &hashMegabytes) && hashMegabytes > 0 &&
+        !mSearchJob.isRunning()) {
+        mTranspositionTable.resize(hashMegabytes);
+    }
+    int maxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    ImGui::SliderInt("Search Threads", &sSearchThreads, 1, maxThreads);
+    if (ImGui::TreeNode("Search Features")) {
+        ImGui::Checkbox("Principal Variation Search", &sSearchOptions.mPrincipalVariationSearch);
+        ImGui::Checkbox("Aspiration Windows", &sSearchOptions.mAspirationWindows);
+        ImGui::Checkbox("Null Move Pruning", &sSearchOptions.mNullMovePruning);
+        ImGui::Checkbox("Late Move Reductions", &sSearchOptions.mLateMoveReductions);
+        ImGui::Checkbox("Check Extensions", &sSearchOptions.mCheckExtensions);
+        ImGui::TreePop();
+    }
+    if (mSearchJob.isRunning()) {
+        SearchProgress progress = mSearchJob.progress();
+        ImGui::Text("Thinking: depth %d, score %d, best %s", progress.mDepth, progress.mScore,
+                    progress.mDepth ? moveToUci(progress.mBestMove).c_str() : "-");
+        ImGui::ProgressBar(std::min(1.f, static_cast<float>(progress.mTimeMs) / sThinkTimeMs));
+        if (ImGui::Button("Move Now")) {
+            mSearchJob.stop();
+        }
+        showSearchStats(progress.mStats, progress.mNodes, progress.mTimeMs);
+    } else if (mLastSearch.mDepth > 0) {
+        ImGui::Text("Last search: depth %d, score %d (%lld ms)", mLastSearch.mDepth,
+                    mLastSearch.mScore, static_cast<long long>(mLastSearch.mTimeMs));
+        showSearchStats(mLastSearch.mStats, mLastSearch.mNodes, mLastSearch.mTimeMs);
+    }
+    // One JSON line per search, for comparing ordering and pruning changes
+    ImGui::Checkbox("Log Search Stats", &sLogSearchStats);
+    ImGui::InputText("Stats Log", sStatsLogPathBuffer, sizeof(sStatsLogPathBuffer));
+    ImGui::InputText("FEN", sFenBuffer, sizeof(sFenBuffer));
+    if (ImGui::Button("Load FEN") && !loadFen(sFenBuffer)) {
+        std::cout << "Invalid FEN: " << sFenBuffer << std::endl;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Current FEN")) {
+        std::snprintf(sFenBuffer, sizeof(sFenBuffer), "%s", fen().c_str());
+    }
+    ImGui::Checkbox("Use Opening Book", &sUseBook);
+    ImGui::InputText("Book File", sBookPathBuffer, sizeof(sBookPathBuffer));
+    if (ImGui::Button("Load Book") && !mBook.open(sBookPathBuffer)) {
+        std::cout << "Cannot load a book from " << sBookPathBuffer << std::endl;
+    }
+    ImGui::SameLine();
+    ImGui::Text("%zu entries", mBook.size());
+    ImGui::InputText("Tablebases", sTablebasePathBuffer, sizeof(sTablebasePathBuffer));
+    // The tables are remapped, so no search may be probing them
+    if (ImGui::Button("Load Tablebases")) {
+        cancelBestMove();
+        Tablebases::init(sTablebasePathBuffer);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%d tables", Tablebases::count());
+    ImGui::InputText("PGN File", sPgnPathBuffer, sizeof(sPgnPathBuffer));
+    if (ImGui::Button("Save PGN") && !savePgn(sPgnPathBuffer)) {
+        std::cout << "Cannot write " << sPgnPathBuffer << std::endl;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load PGN") && !loadPgn(sPgnPathBuffer)) {
+        std::cout << "Cannot load a game from " << sPgnPathBuffer << std::endl;
+    }
+    // A free move while rules are off rebuilds the position, leaving nothing
+    // before it to undo
+    if (mPosition.canUndo() && ImGui::Button("Undo Last Move")) {
         undoMove();
         switchPlayers();
     }
@@ -567,14 +537,11 @@ void Engine::handleImGui() {
                 ImGui::TableHeadersRow();
             }
 
-            std::stack<Move> st = mMoveHistory;
-
-            while (!st.empty()) {
-                auto move = st.top();
-                st.pop();
-                auto pieceName = move.mOccupier->getName();
-                auto pieceFrom = move.mFrom->getPostion();
-                auto pieceTo = move.mTo->getPostion();
+            for (auto it = mMoveHistory.rbegin(); it != mMoveHistory.rend(); ++it) {
+                const MoveRecord &move = *it;
+                auto pieceName = Piece::name(pieceColor(move.mPiece), pieceType(move.mPiece));
+                auto pieceFrom = mBoard->squareAtIndex(move.mMove.from())->getPostion();
+                auto pieceTo = mBoard->squareAtIndex(move.mMove.to())->getPostion();
 
                 ImGui::TableNextRow();
                 ImGui::TableSetColumnIndex(0);
@@ -588,8 +555,9 @@ void Engine::handleImGui() {
                                   " Y: " + std::to_string(int(pieceTo.y)));
                 ImGui::TextUnformatted(to.c_str());
                 ImGui::TableSetColumnIndex(3);
-                if (move.mOpponent != nullptr) {
-                    auto opponent = move.mOpponent->getName();
+                if (move.mCaptured != kNoPiece) {
+                    auto opponent =
+                        Piece::name(pieceColor(move.mCaptured), pieceType(move.mCaptured));
                     ImGui::TextUnformatted(opponent.c_str());
                     ImGui::TableSetColumnIndex(4);
                     ImGui::TextUnformatted(to.c_str());
@@ -627,6 +595,7 @@ void Engine::handleImGui() {
 void Engine::loop() {
     while (mRenderer.isRunning()) {
         handleInput();
+        pollBestMove();
         mRenderer.drawBoard(mBoard, false);
 #ifdef IMGUI_MODE
         handleImGui();
@@ -634,60 +603,26 @@ void Engine::loop() {
         mRenderer.update();
         sf::sleep(sf::milliseconds(10));
     }
+    // The window is gone; don't leave a search running behind it
+    cancelBestMove();
 }
 
 Piece::PiecePtr Engine::findKing(EPieceColor pColor) const {
-    if (pColor == EPieceColor::WHITE) {
-        return mBoard->getPieces()[28];
-    }
-    return mBoard->getPieces()[29];
-}
-
-std::vector<Piece::PiecePtr> Engine::getOpponents(EPieceColor pColor) const {
-    std::vector<Piece::PiecePtr> opponents;
-    for (auto &p : mBoard->getPieces()) {
-        if (p->mColor != pColor && p->mSquare) {
-            opponents.push_back(p);
-        }
+    int square = mPosition.kingSquare(pColor);
+    if (square == kNoSquare) {
+        return nullptr;
     }
-    return opponents;
+    return mBoard->squareAtIndex(square)->getOccupier();
 }
 
-bool Engine::isPlayerInCheck(EPieceColor pColor) {
-    Piece::PiecePtr king = findKing(pColor);
-    if (!king) return false;
-
-    Square::SquarePtr kingSquare = king->mSquare;
-    // kingSquare->deSelect();
-    auto opponenets = getOpponents(pColor);
-
-    for (auto &p : opponenets) {
-        auto moves = generatePossibleMoves(p);
-        if (std::find(moves.begin(), moves.end(), kingSquare) != moves.end()) {
-            return true;
-        }
-    }
-    return false;
-}
-
-bool Engine::wouldExposeKing(Move &m) {
-    makeMove(m);
-    bool exposed = isPlayerInCheck(mCurrentPlayer->mPlayerColor);
-    undoMove();
-    return exposed;
-}
+bool Engine::isPlayerInCheck(EPieceColor pColor) { return mPosition.isInCheck(pColor); }
 
 void Engine::checkForCheckmate() {
     if (!isPlayerInCheck(mCurrentPlayer->mPlayerColor)) {
         return;
     }
-    auto king = findKing(mCurrentPlayer->mPlayerColor);
-    auto moves = generateAllPossibleMoves(mCurrentPlayer->mPlayerColor);
-
-    for (auto &m : moves) {
-        if (!wouldExposeKing(m)) {
-            return;
-        }
+    if (!generateAllPossibleMoves().empty()) {
+        return;
     }
 
     declareCheckmate();
@@ -696,262 +631,156 @@ void Engine::checkForCheckmate() {
 
 void Engine::declareCheckmate() { std::cout << "Checkmate" << std::endl; }
 
+void Engine::declareStalemate() { std::cout << "Stalemate" << std::endl; }
+
 void Engine::endGame() { resetEngine(); }
 
-std::vector<Move> Engine::generateAllPossibleMoves(EPieceColor pPieceColor) {
+MoveList Engine::generateAllPossibleMoves() {
     mLegalMoves.clear();
-    std::vector<Move> moves;
-    for (auto &p : mBoard->getPieces()) {
-        if (p->getColor() == pPieceColor && p->mSquare) {
-            // std::cout << "Generating Moves for: " << p->getName() << std::endl;
-            auto legalMoves = generatePossibleMoves(p);
-            for (auto &s : legalMoves) {
-                Piece::PiecePtr opponent = nullptr;
-                Move move(p, opponent, p->mSquare, s);
-                if (s->isOccupied() && s->getOccupier()->getType() == EPieceType::KING) {
-                    continue;
-                }
-                if (s->isOccupied()) {
-                    opponent = s->getOccupier();
-                    move.mMoveType = MoveType::CAPTURE;
-                }
-                move.mOpponent = opponent;
-                moves.push_back(move);
-            }
-        }
-    }
+    MoveList moves;
+    generateLegalMoves(mPosition, moves);
     return moves;
 }
 
-int Engine::getPieceValue(EPieceType pType) const {
-    switch (pType) {
-        case EPieceType::PAWN: return 100;
-        case EPieceType::KNIGHT: return 320;
-        case EPieceType::BISHOP: return 330;
-        case EPieceType::ROOK: return 500;
-        case EPieceType::QUEEN: return 900;
-        case EPieceType::KING: return 20000;
-        default: return 0;
-    }
-}
+int Engine::getPieceValue(EPieceType pType) const { return pieceValue(pType); }
 
-int Engine::evaluateBoard() const {
-    int score = 0;
-    // Material evaluation
-    for (auto &p : mBoard->getPieces()) {
-        if (p->mSquare) {
-            int pieceValue = getPieceValue(p->getType());
-            score += (p->getColor() == EPieceColor::WHITE) ? pieceValue : -pieceValue;
+int Engine::evaluateBoard() const { return evaluate(mPosition); }
 
-            // Pawn advancement bonus
-            if (p->getType() == EPieceType::PAWN) {
-                int rank = p->mSquare->getY();
-                score += (p->getColor() == EPieceColor::WHITE ? rank : 7 - rank) * 10;
-            }
-
-            // Position-based evaluation
-            if (p->getType() == EPieceType::KNIGHT || p->getType() == EPieceType::BISHOP) {
-                // Bonus for developed pieces
-                int rank = p->mSquare->getY();
-                int file = p->mSquare->getX();
-                int centerDistance = std::abs(3.5 - file) + std::abs(3.5 - rank);
-                int developmentBonus = (8 - centerDistance) * 5;
-                score +=
-                    (p->getColor() == EPieceColor::WHITE) ? developmentBonus : -developmentBonus;
-            }
+bool Engine::findPositionMove(Square::SquarePtr pFrom, Square::SquarePtr pTo,
+                              PositionMove &pMove) {
+    // Promotions are generated queen first, so the GUI always promotes to a queen
+    for (auto &m : generateAllPossibleMoves()) {
+        if (m.from() == pFrom->getIndex() && m.to() == pTo->getIndex()) {
+            pMove = m;
+            return true;
         }
     }
-
-    return score;
-}
-
-void printMove(Move pMove, bool undo) {
-    if (undo) {
-        std::cout << "Undoing Move..." << "\n";
-    } else {
-        std::cout << "Making Move..." << "\n";
-    }
-    std::cout << pMove.mOccupier->getName() << " From: " << pMove.mFrom->getX() << " "
-              << pMove.mFrom->getY();
-    std::cout << " To: " << pMove.mTo->getX() << " " << pMove.mTo->getY() << " ";
-    if (pMove.mOpponent) {
-        std::cout << pMove.mOpponent->getName() << std::endl;
-    } else {
-        std::cout << std::endl;
-    }
+    return false;
 }
 
-void Engine::makeMove(Move pMove) {
-    // printMove(pMove, false);
-    pMove.mFirstMove = false;
-    if (!pMove.mOccupier->mMovedBefore) {
-        pMove.mFirstMove = true;
-        pMove.mOccupier->mMovedBefore = true;
+void Engine::syncPositionFromBoard() {
+    mPosition.clear();
+    for (auto &p : mBoard->getPieces()) {
+        if (p->mSquare) {
+            mPosition.putPiece(p->mSquare->getIndex(), p->getColor(), p->getType());
+        }
     }
-    mMoveHistory.push(pMove);
-    auto occupier = pMove.mOccupier;
-    auto opponent = pMove.mOpponent;
-    auto from = pMove.mFrom;
-    auto to = pMove.mTo;
 
-    if (to->isOccupied()) {
-        to->clear();
+    auto unmoved = [&](int pSquare, EPieceType pType, EPieceColor pColor) {
+        auto occupier = mBoard->squareAtIndex(pSquare)->getOccupier();
+        return occupier && occupier->getType() == pType && occupier->getColor() == pColor &&
+               !occupier->mMovedBefore;
+    };
+    int rights = 0;
+    if (unmoved(4, EPieceType::KING, EPieceColor::WHITE)) {
+        rights |= unmoved(7, EPieceType::ROOK, EPieceColor::WHITE) ? kWhiteKingSide : 0;
+        rights |= unmoved(0, EPieceType::ROOK, EPieceColor::WHITE) ? kWhiteQueenSide : 0;
+    }
+    if (unmoved(60, EPieceType::KING, EPieceColor::BLACK)) {
+        rights |= unmoved(63, EPieceType::ROOK, EPieceColor::BLACK) ? kBlackKingSide : 0;
+        rights |= unmoved(56, EPieceType::ROOK, EPieceColor::BLACK) ? kBlackQueenSide : 0;
+    }
+    mPosition.setCastlingRights(rights);
+
+    if (!mMoveHistory.empty()) {
+        const PositionMove &lastMove = mMoveHistory.back().mMove;
+        if (pieceType(mMoveHistory.back().mPiece) == EPieceType::PAWN &&
+            std::abs(rankOf(lastMove.from()) - rankOf(lastMove.to())) == 2) {
+            mPosition.setEnPassantSquare((lastMove.from() + lastMove.to()) / 2);
+        }
     }
-    from->clear();
-    occupier->setSquare(to);
-    // occupier->mMovedBefore = true;
-    to->setOccupier(occupier);
+    mPosition.setSideToMove(mCurrentPlayer->mPlayerColor);
 }
 
-void Engine::undoMove() {
-    auto pMove = mMoveHistory.top();
-    // printMove(pMove, true);
-    mMoveHistory.pop();
-    if (pMove.mFirstMove) {
-        pMove.mOccupier->mMovedBefore = false;
-    }
-    auto occupier = pMove.mOccupier;
-    auto opponent = pMove.mOpponent;
-    auto from = pMove.mFrom;
-    auto to = pMove.mTo;
-    to->clear();
-    if (opponent) {
-        to->setOccupier(opponent);
-        opponent->setSquare(to);
+void Engine::animateMove(const PositionMove &pMove) {
+    if (!isAnimationEnabled()) {
+        return;
     }
+    auto from = mBoard->squareAtIndex(pMove.from());
+    auto to = mBoard->squareAtIndex(pMove.to());
+    auto occupier = from->getOccupier();
     from->clear();
-    from->setOccupier(occupier);
     occupier->setSquare(from);
+    mAnimationEngine.animateMovement(occupier, from->getPostion(), to->getPostion());
+    from->setOccupier(occupier);
 }
 
-int Engine::minimax(int pDepth, int pAlpha, int pBeta, bool pIsMaximizing) {
-    if (pDepth == 0) {
-        return evaluateBoard();
-    }
-
-    std::vector<Move> moves =
-        generateAllPossibleMoves(pIsMaximizing ? EPieceColor::WHITE : EPieceColor::BLACK);
-
-    // Sort moves to improve alpha-beta pruning
-    std::sort(moves.begin(), moves.end(), [&](const Move &m1, const Move &m2) {
-        if (m1.mMoveType == MoveType::CAPTURE && m2.mMoveType != MoveType::CAPTURE) return true;
-        if (m1.mMoveType == MoveType::CAPTURE && m2.mMoveType == MoveType::CAPTURE) {
-            return getPieceValue(m1.mOpponent->getType()) > getPieceValue(m2.mOpponent->getType());
-        }
-        return false;
-    });
-
-    if (pIsMaximizing) {
-        int maxEval = -100000;
-        for (auto &move : moves) {
-            if (wouldExposeKing(move)) {
-                continue;
-            }
-            makeMove(move);
-            int eval = minimax(pDepth - 1, pAlpha, pBeta, false);
-            undoMove();
+void Engine::makeMove(const PositionMove &pMove) {
+    MoveRecord record;
+    record.mMove = pMove;
+    record.mPiece = mPosition.pieceAt(pMove.from());
+    record.mCaptured = mPosition.capturedPiece(pMove);
+    mMoveHistory.push_back(record);
 
-            maxEval = std::max(maxEval, eval);
-            pAlpha = std::max(pAlpha, eval);
-            if (pBeta <= pAlpha) break;
-        }
-        return maxEval;
-    } else {
-        int minEval = 100000;
-        for (auto &move : moves) {
-            if (wouldExposeKing(move)) {
-                continue;
-            }
-            makeMove(move);
-            int eval = minimax(pDepth - 1, pAlpha, pBeta, true);
-            undoMove();
+    mPosition.makeMove(pMove);
+    mBoard->loadPosition(mPosition);
+}
 
-            minEval = std::min(minEval, eval);
-            pBeta = std::min(pBeta, eval);
-            if (pBeta <= pAlpha) break;
-        }
-        return minEval;
+void Engine::undoMove() {
+    cancelBestMove();
+    if (mMoveHistory.empty() || !mPosition.canUndo()) {
+        return;
     }
+    mMoveHistory.pop_back();
+    mPosition.undoMove();
+    mBoard->loadPosition(mPosition);
 }
 
 void Engine::makeBestMove() {
-    int bestMoveValue = -100000;
-    Move bestMove;
-    auto possibleMoves = generateAllPossibleMoves(EPieceColor::BLACK);
-    std::vector<Move> moves;
-
-    for (auto &move : possibleMoves) {
-        if (wouldExposeKing(move)) {
-            continue;
-        }
-        makeMove(move);
-        int moveValue = minimax(3, -100000, 100000, false);
-
-        // Add capture bonus BEFORE comparison
-        if (move.mMoveType == MoveType::CAPTURE) {
-            moveValue += getPieceValue(move.mOpponent->getType());  // Increase capture incentive
-        }
-
-        undoMove();
-
-        if (moveValue > bestMoveValue) {
-            moves.clear();
-            moves.push_back(move);
-            bestMoveValue = moveValue;
-            bestMove = move;
-        } else if (moveValue == bestMoveValue) {
-            moves.push_back(move);
-        }
+    // Book moves are played at once, keeping the whole budget for later moves
+    PositionMove bookMove = sUseBook ? mBook.pick(mPosition, rng) : PositionMove();
+    if (!bookMove.isNull()) {
+        mCurrentPlayer = mCurrentPlayer->mNext;
+        mRenderer.mDrawFlag = true;
+        animateMove(bookMove);
+        makeMove(bookMove);
+        return;
     }
 
-    if (!moves.empty()) {
-        // Prioritize captures and higher-value captures
-        std::sort(moves.begin(), moves.end(), [&](const Move &m1, const Move &m2) {
-            // First priority: captures vs non-captures
-            if (m1.mMoveType == MoveType::CAPTURE && m2.mMoveType != MoveType::CAPTURE) return true;
-            if (m1.mMoveType != MoveType::CAPTURE && m2.mMoveType == MoveType::CAPTURE)
-                return false;
-
-            // Second priority: value of captured piece
-            if (m1.mMoveType == MoveType::CAPTURE && m2.mMoveType == MoveType::CAPTURE) {
-                return getPieceValue(m1.mOpponent->getType()) >
-                       getPieceValue(m2.mOpponent->getType());
-            }
-
-            // For non-captures, maintain some randomness
-            return false;
-        });
+    // Iterations stop starting halfway through the budget so the last one can finish
+    SearchLimits limits;
+    limits.mSoftTimeMs = sThinkTimeMs / 2;
+    limits.mHardTimeMs = sThinkTimeMs;
+    // The search runs in the background; loop() plays its move once it is done
+    mInputDispatcher.disableLocalInput();
+    mSearchJob.start(mPosition, limits, sSearchThreads, sSearchOptions);
+}
 
-        // Select best capture if available, otherwise random move
-        if (moves[0].mMoveType == MoveType::CAPTURE) {
-            bestMove = moves[0];  // Take the highest-value capture
+void Engine::pollBestMove() {
+    SearchResult result;
+    if (!mSearchJob.takeResult(result)) {
+        return;
+    }
+    mInputDispatcher.enableLocalInput();
+    mRenderer.mDrawFlag = true;
+    mLastSearch = result;
+    if (sLogSearchStats) {
+        std::ofstream log(sStatsLogPathBuffer, std::ios::app);
+        if (log) {
+            log << searchStatsJson(result) << '\n';
         } else {
-            std::uniform_int_distribution<> dist(0, moves.size() - 1);
-            bestMove = moves[dist(rng)];
+            std::cout << "Cannot write " << sStatsLogPathBuffer << std::endl;
         }
+    }
 
-        if (wouldExposeKing(bestMove)) {
-            for (auto &m : moves) {
-                if (!wouldExposeKing(m)) {
-                    bestMove = m;
-                    break;
-                }
-            }
+    std::vector<PositionMove> &moves = result.mTiedMoves;
+    if (moves.empty()) {
+        // Nothing to play: the side to move is mated or stalemated
+        if (isPlayerInCheck(mPosition.sideToMove())) {
+            declareCheckmate();
+        } else {
+            declareStalemate();
         }
+        endGame();
+        return;
     }
-    bestMove.mFrom->clear();
-    bestMove.mOccupier->setSquare(bestMove.mFrom);
-    if (isAnimationEnabled()) {
-        mAnimationEngine.animateMovement(bestMove.mOccupier, bestMove.mFrom->getPostion(),
-                                         bestMove.mTo->getPostion());
-    }
-    bestMove.mFrom->setOccupier(bestMove.mOccupier);
+
+    // The search scores captures through to quiet positions, so moves it rates
+    // equal are equally good; pick among them at random for variety
+    std::uniform_int_distribution<> dist(0, moves.size() - 1);
+    PositionMove bestMove = moves[dist(rng)];
+
+    mCurrentPlayer = mCurrentPlayer->mNext;
+    animateMove(bestMove);
     makeMove(bestMove);
 }
-
-Move::Move(Piece::PiecePtr pPiece, Piece::PiecePtr pOpponent, Square::SquarePtr pFrom,
-           Square::SquarePtr pTo)
-    : mOccupier(pPiece)
-    , mFrom(pFrom)
-    , mTo(pTo)
-    , mOpponent(pOpponent) {}
@@ -0,0 +1,87 @@
+#include "evaluation.h"
+
+#include <algorithm>
+
+#include "bitboard.h"
+#include "position.h"
+#include "psqt.h"
+
+int pieceValue(EPieceType pType) {
+    switch (pType) {
+        case EPieceType::PAWN: return 100;
+        case EPieceType::KNIGHT: return 320;
+        case EPieceType::BISHOP: return 330;
+        case EPieceType::ROOK: return 500;
+        case EPieceType::QUEEN: return 900;
+        case EPieceType::KING: return 20000;
+        default: return 0;
+    }
+}
+
+int evaluate(const Position &pPosition) {
+    // Material and piece-square terms are kept up to date by the position;
+    // only the blend between their midgame and endgame values is left to do
+    const ScorePair &score = pPosition.psqScore();
+    int phase = std::min(pPosition.gamePhase(), PieceSquareTable::kMaxPhase);
+    return (score.mMidgame * phase + score.mEndgame * (PieceSquareTable::kMaxPhase - phase)) /
+           PieceSquareTable::kMaxPhase;
+}
+
+int staticExchange(const Position &pPosition, const PositionMove &pMove) {
+    // Least valuable attacker first
+    constexpr EPieceType kAttackerOrder[] = {EPieceType::PAWN,   EPieceType::KNIGHT,
+                                             EPieceType::BISHOP, EPieceType::ROOK,
+                                             EPieceType::QUEEN,  EPieceType::KING};
+    const int from = pMove.from();
+    const int to = pMove.to();
+    EPieceColor side = pPosition.sideToMove();
+    Bitboard occupied = pPosition.occupied() ^ squareBit(from);
+
+    // gain[d] is the material won at depth d of the capture sequence if it stopped there
+    int gain[32];
+    int depth = 0;
+    PieceCode captured = pPosition.capturedPiece(pMove);
+    gain[0] = captured == kNoPiece ? 0 : pieceValue(pieceType(captured));
+    if (pMove.flag() == EMoveFlag::EN_PASSANT) {
+        occupied ^= squareBit(to + (side == EPieceColor::WHITE ? -8 : 8));
+    }
+    int onSquare = pieceValue(pieceType(pPosition.pieceAt(from)));
+    if (pMove.isPromotion()) {
+        int promoted = pieceValue(pMove.promotion());
+        gain[0] += promoted - pieceValue(EPieceType::PAWN);
+        onSquare = promoted;
+    }
+
+    while (depth < 31) {
+        side = ~side;
+        // Sliders behind the pieces already traded join in as occupancy shrinks
+        Bitboard attackers = pPosition.attackersTo(to, occupied) & occupied & pPosition.pieces(side);
+        if (!attackers) {
+            break;
+        }
+        EPieceType attacker = EPieceType::KING;
+        Bitboard candidates = 0;
+        for (EPieceType type : kAttackerOrder) {
+            candidates = attackers & pPosition.pieces(side, type);
+            if (candidates) {
+                attacker = type;
+                break;
+            }
+        }
+        // The king may only recapture when nothing can take it back
+        if (attacker == EPieceType::KING &&
+            (pPosition.attackersTo(to, occupied) & occupied & pPosition.pieces(~side))) {
+            break;
+        }
+        depth++;
+        gain[depth] = onSquare - gain[depth - 1];
+        onSquare = pieceValue(attacker);
+        occupied ^= squareBit(lsb(candidates));
+    }
+    // Either side may decline to continue the exchange
+    while (depth > 0) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        depth--;
+    }
+    return gain[0];
+}
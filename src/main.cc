@@ -1,7 +1,14 @@
+#include <iostream>
+
 #include "engine.h"
 
-int main() {
+int main(int argc, char **argv) {
     Engine engine{};
+    // An optional FEN record sets up the starting position
+    if (argc > 1 && !engine.loadFen(argv[1])) {
+        std::cerr << "Invalid FEN: " << argv[1] << std::endl;
+        return 1;
+    }
 
     engine.loop();
 }
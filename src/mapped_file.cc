@@ -0,0 +1,96 @@
+#include "mapped_file.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&pOther) noexcept { *this = std::move(pOther); }
+
+MappedFile &MappedFile::operator=(MappedFile &&pOther) noexcept {
+    if (this != &pOther) {
+        close();
+        mData = std::exchange(pOther.mData, nullptr);
+        mSize = std::exchange(pOther.mSize, 0);
+        mMapped = std::exchange(pOther.mMapped, false);
+        mOpen = std::exchange(pOther.mOpen, false);
+        mBuffer = std::move(pOther.mBuffer);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &pPath) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(pPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    mSize = static_cast<size_t>(info.st_size);
+    if (mSize == 0) {
+        // Empty files can't be mapped but are valid
+        ::close(fd);
+        mOpen = true;
+        return true;
+    }
+    void *address = ::mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        mSize = 0;
+        return false;
+    }
+    mData = static_cast<const unsigned char *>(address);
+    mMapped = true;
+    mOpen = true;
+    return true;
+#else
+    std::ifstream file(pPath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    mBuffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    mData = mBuffer.data();
+    mSize = mBuffer.size();
+    mOpen = true;
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mMapped) {
+        ::munmap(const_cast<unsigned char *>(mData), mSize);
+    }
+#endif
+    mData = nullptr;
+    mSize = 0;
+    mMapped = false;
+    mOpen = false;
+    mBuffer.clear();
+}
+
+bool MappedFile::isOpen() const { return mOpen; }
+
+const unsigned char *MappedFile::data() const { return mData; }
+
+size_t MappedFile::size() const { return mSize; }
+
+std::string_view MappedFile::text() const {
+    return std::string_view(reinterpret_cast<const char *>(mData), mSize);
+}
@@ -0,0 +1,106 @@
+#include "move_picker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "evaluation.h"
+#include "movegen.h"
+
+namespace {
+
+// Score bands, each above anything a lower band can reach
+constexpr int kHashMoveScore = 1 << 30;
+constexpr int kCaptureScore = 1 << 28;
+constexpr int kKillerScore = 1 << 27;
+
+// Attacker rank by EPieceType (PAWN, ROOK, BISHOP, QUEEN, KING, KNIGHT), least valuable first
+constexpr int kAttackerRank[kPieceTypeCount] = {0, 3, 2, 4, 5, 1};
+
+}  // namespace
+
+void HistoryTable::clear() { std::memset(mTable, 0, sizeof(mTable)); }
+
+int HistoryTable::value(EPieceColor pColor, const PositionMove &pMove) const {
+    return mTable[static_cast<int>(pColor)][pMove.from()][pMove.to()];
+}
+
+void HistoryTable::update(EPieceColor pColor, const PositionMove &pMove, int pBonus) {
+    int &entry = mTable[static_cast<int>(pColor)][pMove.from()][pMove.to()];
+    pBonus = std::clamp(pBonus, -kMaxValue, kMaxValue);
+    // Scaled so the entry approaches the bound without crossing it, and old
+    // results fade as new ones come in
+    entry += pBonus - entry * std::abs(pBonus) / kMaxValue;
+}
+
+MovePicker::MovePicker(const Position &pPosition, const PositionMove &pHashMove,
+                       const PositionMove *pKillers, const HistoryTable &pHistory)
+    : mPosition(pPosition)
+    , mHistory(pHistory)
+    , mHashMove(pHashMove)
+    , mHasHashMove(false)
+    , mCurrent(0) {
+    generateLegalMoves(mPosition, mMoves);
+    score(pKillers);
+}
+
+MovePicker::MovePicker(const Position &pPosition, const HistoryTable &pHistory)
+    : mPosition(pPosition)
+    , mHistory(pHistory)
+    , mHasHashMove(false)
+    , mCurrent(0) {
+    if (mPosition.checkers()) {
+        generateLegalMoves(mPosition, mMoves);
+    } else {
+        generateLegalCaptures(mPosition, mMoves);
+    }
+    score(nullptr);
+}
+
+void MovePicker::score(const PositionMove *pKillers) {
+    const EPieceColor us = mPosition.sideToMove();
+    for (size_t i = 0; i < mMoves.size(); i++) {
+        const PositionMove &move = mMoves[i];
+        if (!mHashMove.isNull() && move == mHashMove) {
+            mScores[i] = kHashMoveScore;
+            mHasHashMove = true;
+        } else if (move.isCapture() || move.isPromotion()) {
+            // Most valuable victim first, least valuable attacker among equal victims
+            PieceCode captured = mPosition.capturedPiece(move);
+            int gain = captured == kNoPiece ? 0 : pieceValue(pieceType(captured));
+            if (move.isPromotion()) {
+                gain += pieceValue(move.promotion());
+            }
+            int attacker = kAttackerRank[static_cast<int>(pieceType(mPosition.pieceAt(move.from())))];
+            mScores[i] = kCaptureScore + gain * 8 - attacker;
+        } else if (pKillers && move == pKillers[0]) {
+            mScores[i] = kKillerScore;
+        } else if (pKillers && move == pKillers[1]) {
+            mScores[i] = kKillerScore - 1;
+        } else {
+            mScores[i] = mHistory.value(us, move);
+        }
+    }
+}
+
+bool MovePicker::next(PositionMove &pMove) {
+    if (mCurrent == mMoves.size()) {
+        return false;
+    }
+    // One step of selection sort: bring the best remaining move forward
+    size_t best = mCurrent;
+    for (size_t i = mCurrent + 1; i < mMoves.size(); i++) {
+        if (mScores[i] > mScores[best]) {
+            best = i;
+        }
+    }
+    std::swap(mMoves[best], mMoves[mCurrent]);
+    std::swap(mScores[best], mScores[mCurrent]);
+    pMove = mMoves[mCurrent++];
+    return true;
+}
+
+size_t MovePicker::size() const { return mMoves.size(); }
+
+bool MovePicker::hasHashMove() const { return mHasHashMove; }
@@ -0,0 +1,270 @@
+#include "movegen.h"
+
+#include <string>
+
+#include "bitboard.h"
+#include "move_list.h"
+#include "position.h"
+
+// Everything that restricts the side to move, computed once per position
+struct LegalityMasks {
+    int mKing;
+    // Target squares that resolve a single check: the checker and the squares
+    // between it and the king. All squares when not in check.
+    Bitboard mCheckMask;
+    // Our pieces shielding the king from an enemy slider
+    Bitboard mPinned;
+    // Where pawn pushes may land: everywhere, or only the promotion ranks when
+    // generating captures
+    Bitboard mPushMask;
+};
+
+static Bitboard pinnedPieces(const Position &pPosition, EPieceColor pUs, int pKing) {
+    const EPieceColor them = ~pUs;
+    const Bitboard queens = pPosition.pieces(them, EPieceType::QUEEN);
+    Bitboard snipers =
+        (AttackTables::rookAttacks(pKing, 0) & (pPosition.pieces(them, EPieceType::ROOK) | queens)) |
+        (AttackTables::bishopAttacks(pKing, 0) &
+         (pPosition.pieces(them, EPieceType::BISHOP) | queens));
+
+    Bitboard pinned = 0;
+    while (snipers) {
+        Bitboard blockers = AttackTables::between(pKing, popLsb(snipers)) & pPosition.occupied();
+        if (popCount(blockers) == 1) {
+            pinned |= blockers & pPosition.pieces(pUs);
+        }
+    }
+    return pinned;
+}
+
+// A pinned piece may still move along the line through its king
+static Bitboard legalTargets(const LegalityMasks &pMasks, int pFrom, Bitboard pTargets) {
+    pTargets &= pMasks.mCheckMask;
+    if (pMasks.mPinned & squareBit(pFrom)) {
+        pTargets &= AttackTables::line(pMasks.mKing, pFrom);
+    }
+    return pTargets;
+}
+
+static void addPawnMove(MoveList &pMoves, int pFrom, int pTo, bool pCapture) {
+    if (rankOf(pTo) == 0 || rankOf(pTo) == 7) {
+        EMoveFlag flag = pCapture ? EMoveFlag::PROMOTION_CAPTURE : EMoveFlag::PROMOTION;
+        for (EPieceType type :
+             {EPieceType::QUEEN, EPieceType::ROOK, EPieceType::BISHOP, EPieceType::KNIGHT}) {
+            pMoves.push_back(PositionMove(pFrom, pTo, flag, type));
+        }
+        return;
+    }
+    pMoves.push_back(PositionMove(pFrom, pTo, pCapture ? EMoveFlag::CAPTURE : EMoveFlag::QUIET));
+}
+
+// En passant removes two pawns from one rank at once, which no pin mask describes,
+// so the king is tested directly against enemy sliders on the resulting board
+static bool isEnPassantLegal(const Position &pPosition, const LegalityMasks &pMasks, int pFrom,
+                             int pTo, int pCaptured) {
+    if (!(pMasks.mCheckMask & (squareBit(pTo) | squareBit(pCaptured)))) {
+        return false;
+    }
+    if (pMasks.mKing == kNoSquare) {
+        return true;
+    }
+    const EPieceColor them = ~pPosition.sideToMove();
+    const Bitboard queens = pPosition.pieces(them, EPieceType::QUEEN);
+    Bitboard occupied =
+        (pPosition.occupied() ^ squareBit(pFrom) ^ squareBit(pCaptured)) | squareBit(pTo);
+    return !(AttackTables::rookAttacks(pMasks.mKing, occupied) &
+             (pPosition.pieces(them, EPieceType::ROOK) | queens)) &&
+           !(AttackTables::bishopAttacks(pMasks.mKing, occupied) &
+             (pPosition.pieces(them, EPieceType::BISHOP) | queens));
+}
+
+static void generatePawnMoves(const Position &pPosition, const LegalityMasks &pMasks,
+                              MoveList &pMoves) {
+    const EPieceColor us = pPosition.sideToMove();
+    const Bitboard empty = ~pPosition.occupied();
+    const Bitboard enemies = pPosition.pieces(~us);
+    const int forward = (us == EPieceColor::WHITE) ? 8 : -8;
+    const Bitboard startRank = (us == EPieceColor::WHITE) ? kRank2 : kRank7;
+    const int enPassant = pPosition.enPassantSquare();
+
+    Bitboard pawns = pPosition.pieces(us, EPieceType::PAWN);
+    while (pawns) {
+        int from = popLsb(pawns);
+        int to = from + forward;
+        if (to >= 0 && to < kSquareCount && (empty & squareBit(to))) {
+            Bitboard pushes = squareBit(to);
+            int doubleTo = to + forward;
+            if ((squareBit(from) & startRank) && (empty & squareBit(doubleTo))) {
+                pushes |= squareBit(doubleTo);
+            }
+            pushes = legalTargets(pMasks, from, pushes & pMasks.mPushMask);
+            if (pushes & squareBit(to)) {
+                addPawnMove(pMoves, from, to, false);
+            }
+            if (pushes & ~squareBit(to)) {
+                pMoves.push_back(PositionMove(from, doubleTo, EMoveFlag::DOUBLE_PUSH));
+            }
+        }
+
+        Bitboard attacks = AttackTables::pawnAttacks(us, from);
+        Bitboard captures = legalTargets(pMasks, from, attacks & enemies);
+        while (captures) {
+            addPawnMove(pMoves, from, popLsb(captures), true);
+        }
+        if (enPassant != kNoSquare && (attacks & squareBit(enPassant)) &&
+            isEnPassantLegal(pPosition, pMasks, from, enPassant, enPassant - forward)) {
+            pMoves.push_back(PositionMove(from, enPassant, EMoveFlag::EN_PASSANT));
+        }
+    }
+}
+
+static void addPieceMoves(const Position &pPosition, MoveList &pMoves, int pFrom,
+                          Bitboard pTargets) {
+    const Bitboard enemies = pPosition.pieces(~pPosition.sideToMove());
+    while (pTargets) {
+        int to = popLsb(pTargets);
+        EMoveFlag flag = (enemies & squareBit(to)) ? EMoveFlag::CAPTURE : EMoveFlag::QUIET;
+        pMoves.push_back(PositionMove(pFrom, to, flag));
+    }
+}
+
+static void generateKingMoves(const Position &pPosition, const LegalityMasks &pMasks,
+                              Bitboard pTargets, MoveList &pMoves) {
+    const EPieceColor us = pPosition.sideToMove();
+    const Bitboard enemies = pPosition.pieces(~us);
+    // The king no longer blocks the rays of the sliders checking it
+    const Bitboard occupied = pPosition.occupied() ^ squareBit(pMasks.mKing);
+    Bitboard targets = AttackTables::kingAttacks(pMasks.mKing) & pTargets;
+    Bitboard safe = 0;
+    while (targets) {
+        int to = popLsb(targets);
+        if (!(pPosition.attackersTo(to, occupied) & enemies)) {
+            safe |= squareBit(to);
+        }
+    }
+    addPieceMoves(pPosition, pMoves, pMasks.mKing, safe);
+}
+
+static void generateCastling(const Position &pPosition, MoveList &pMoves) {
+    const EPieceColor us = pPosition.sideToMove();
+    const int rights = pPosition.castlingRights();
+    const int kingSide = (us == EPieceColor::WHITE) ? kWhiteKingSide : kBlackKingSide;
+    const int queenSide = (us == EPieceColor::WHITE) ? kWhiteQueenSide : kBlackQueenSide;
+    if (!(rights & (kingSide | queenSide))) {
+        return;
+    }
+
+    const int king = (us == EPieceColor::WHITE) ? 4 : 60;
+    const Bitboard occupied = pPosition.occupied();
+    // Rights are dropped when the king or rook leaves home, but positions set
+    // up by hand may still claim them
+    const PieceCode rook = makePiece(us, EPieceType::ROOK);
+    if (pPosition.pieceAt(king) != makePiece(us, EPieceType::KING)) {
+        return;
+    }
+    if ((rights & kingSide) && pPosition.pieceAt(king + 3) == rook &&
+        !(occupied & (squareBit(king + 1) | squareBit(king + 2))) &&
+        !pPosition.isSquareAttacked(king + 1, ~us) && !pPosition.isSquareAttacked(king + 2, ~us)) {
+        pMoves.push_back(PositionMove(king, king + 2, EMoveFlag::KING_CASTLE));
+    }
+    if ((rights & queenSide) && pPosition.pieceAt(king - 4) == rook &&
+        !(occupied & (squareBit(king - 1) | squareBit(king - 2) | squareBit(king - 3))) &&
+        !pPosition.isSquareAttacked(king - 1, ~us) && !pPosition.isSquareAttacked(king - 2, ~us)) {
+        pMoves.push_back(PositionMove(king, king - 2, EMoveFlag::QUEEN_CASTLE));
+    }
+}
+
+static constexpr int typeBit(EPieceType pType) { return 1 << static_cast<int>(pType); }
+
+// Moves of the piece types in pTypes, a mask of typeBit()s; castling counts
+// as a king move
+static void generate(const Position &pPosition, MoveList &pMoves, bool pCapturesOnly,
+                     int pTypes) {
+    const EPieceColor us = pPosition.sideToMove();
+    const Bitboard occupied = pPosition.occupied();
+    const Bitboard checkers = pPosition.checkers();
+    const Bitboard targets = pCapturesOnly ? pPosition.pieces(~us) : ~pPosition.pieces(us);
+
+    LegalityMasks masks;
+    masks.mKing = pPosition.kingSquare(us);
+    masks.mCheckMask = ~Bitboard(0);
+    masks.mPinned = 0;
+    masks.mPushMask = pCapturesOnly ? (kRank1 | kRank8) : ~Bitboard(0);
+    // Positions edited with the rules disabled may lack a king; nothing is then pinned
+    if (masks.mKing != kNoSquare) {
+        if (pTypes & typeBit(EPieceType::KING)) {
+            generateKingMoves(pPosition, masks, targets, pMoves);
+        }
+        // In double check only the king can move
+        if (popCount(checkers) > 1) {
+            return;
+        }
+        if (checkers) {
+            masks.mCheckMask = checkers | AttackTables::between(masks.mKing, lsb(checkers));
+        } else if (!pCapturesOnly && (pTypes & typeBit(EPieceType::KING))) {
+            generateCastling(pPosition, pMoves);
+        }
+        masks.mPinned = pinnedPieces(pPosition, us, masks.mKing);
+    }
+
+    if (pTypes & typeBit(EPieceType::PAWN)) {
+        generatePawnMoves(pPosition, masks, pMoves);
+    }
+
+    auto piecesOf = [&](EPieceType pType) {
+        return (pTypes & typeBit(pType)) ? pPosition.pieces(us, pType) : 0;
+    };
+    Bitboard knights = piecesOf(EPieceType::KNIGHT) & ~masks.mPinned;
+    while (knights) {
+        int from = popLsb(knights);
+        addPieceMoves(pPosition, pMoves, from,
+                      legalTargets(masks, from, AttackTables::knightAttacks(from) & targets));
+    }
+    Bitboard bishops = piecesOf(EPieceType::BISHOP);
+    while (bishops) {
+        int from = popLsb(bishops);
+        addPieceMoves(
+            pPosition, pMoves, from,
+            legalTargets(masks, from, AttackTables::bishopAttacks(from, occupied) & targets));
+    }
+    Bitboard rooks = piecesOf(EPieceType::ROOK);
+    while (rooks) {
+        int from = popLsb(rooks);
+        addPieceMoves(
+            pPosition, pMoves, from,
+            legalTargets(masks, from, AttackTables::rookAttacks(from, occupied) & targets));
+    }
+    Bitboard queens = piecesOf(EPieceType::QUEEN);
+    while (queens) {
+        int from = popLsb(queens);
+        addPieceMoves(
+            pPosition, pMoves, from,
+            legalTargets(masks, from, AttackTables::queenAttacks(from, occupied) & targets));
+    }
+}
+
+// Every piece type
+static constexpr int kAllTypes = (1 << kPieceTypeCount) - 1;
+
+void generateLegalMoves(const Position &pPosition, MoveList &pMoves) {
+    generate(pPosition, pMoves, false, kAllTypes);
+}
+
+void generateLegalCaptures(const Position &pPosition, MoveList &pMoves) {
+    generate(pPosition, pMoves, true, kAllTypes);
+}
+
+void generateLegalPieceMoves(const Position &pPosition, EPieceType pType, MoveList &pMoves) {
+    generate(pPosition, pMoves, false, typeBit(pType));
+}
+
+PositionMove parseUciMove(const Position &pPosition, const std::string &pText) {
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+    for (auto &move : moves) {
+        if (moveToUci(move) == pText) {
+            return move;
+        }
+    }
+    return PositionMove();
+}
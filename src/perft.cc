@@ -0,0 +1,56 @@
+#include "perft.h"
+
+#include <vector>
+
+#include "move_list.h"
+#include "movegen.h"
+#include "position.h"
+
+uint64_t perft(Position &pPosition, int pDepth, bool pBulk) {
+    if (pDepth == 0) {
+        return 1;
+    }
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+    if (pBulk && pDepth == 1) {
+        return moves.size();
+    }
+
+    uint64_t nodes = 0;
+    for (auto &move : moves) {
+        pPosition.makeMove(move);
+        nodes += perft(pPosition, pDepth - 1, pBulk);
+        pPosition.undoMove();
+    }
+    return nodes;
+}
+
+std::vector<PerftDivide> perftDivide(Position &pPosition, int pDepth, bool pBulk) {
+    std::vector<PerftDivide> divide;
+    if (pDepth <= 0) {
+        return divide;
+    }
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+    for (auto &move : moves) {
+        pPosition.makeMove(move);
+        divide.push_back({move, perft(pPosition, pDepth - 1, pBulk)});
+        pPosition.undoMove();
+    }
+    return divide;
+}
+
+const std::vector<PerftCase> &perftSuite() {
+    static const std::vector<PerftCase> sSuite = {
+        {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4,
+         4085603},
+        {"endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+        {"promotion", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4,
+         422333},
+        {"talkchess", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+        {"middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+         4, 3894594},
+    };
+    return sSuite;
+}
@@ -0,0 +1,190 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "opening_book.h"
+#include "perft.h"
+#include "position.h"
+#include "tablebase.h"
+
+static const char *kUsage =
+    "usage: perft <depth> [fen]   divide counts from a FEN (default: start position)\n"
+    "       perft --suite         run the reference positions and check node counts\n"
+    "                             and Polyglot book keys\n"
+    "options:\n"
+    "       --syzygy <dir>        where --suite looks for KRvK and KQvK tables\n"
+    "                             (default: tablebases)\n"
+    "       --no-bulk             make every leaf move instead of counting the last ply\n";
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point pStart) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - pStart).count();
+}
+
+struct KeyCase {
+    const char *mName;
+    const char *mFen;
+    uint64_t mKey;
+};
+
+// The positions and keys published with the Polyglot book format
+static const KeyCase kPolyglotKeys[] = {
+    {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463b96181691fc9cULL},
+    {"e4", "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196ULL},
+    {"e4 d5", "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2",
+     0x0756b94461c50fb0ULL},
+    {"e4 d5 e5", "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2",
+     0x662fafb965db29d4ULL},
+    {"e4 d5 e5 f5", "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+     0x22a48b5a8e47ff78ULL},
+    {"... Ke2", "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3",
+     0x652a607ca3f242c1ULL},
+    {"... Kf7", "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4",
+     0x00fdd303c946bdd9ULL},
+    {"a4 b5 h4 b4 c4", "rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3",
+     0x3c8123ea7b067637ULL},
+    {"... bxc3 Ra3", "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4",
+     0x5c3f9b829b279560ULL},
+};
+
+static int runKeySuite() {
+    int failures = 0;
+    for (const auto &test : kPolyglotKeys) {
+        Position position;
+        position.setFromFen(test.mFen);
+        uint64_t key = polyglotKey(position);
+        bool passed = key == test.mKey;
+        failures += passed ? 0 : 1;
+        std::printf("%-16s polyglot key %016llx  %s\n", test.mName,
+                    static_cast<unsigned long long>(key), passed ? "ok  " : "FAIL");
+    }
+    if (failures) {
+        std::printf("%d key(s) FAILED\n", failures);
+    }
+    return failures;
+}
+
+struct TablebaseCase {
+    const char *mFen;
+    int mWdl;
+    int mDtz;
+};
+
+// Positions whose results follow from the rules alone: mates in one and two,
+// the rook taken at once, a stalemate
+static const TablebaseCase kTablebaseCases[] = {
+    {"k7/8/1K6/8/8/8/8/7R w - - 0 1", Tablebases::kWin, 1},
+    {"k7/8/1K6/8/8/8/8/7R b - - 0 1", Tablebases::kLoss, -2},
+    {"8/8/8/8/8/4K3/8/kR6 b - - 0 1", Tablebases::kDraw, 0},
+    {"k7/8/1K6/8/8/7Q/8/8 w - - 0 1", Tablebases::kWin, 1},
+    {"k7/8/1K6/8/8/7Q/8/8 b - - 0 1", Tablebases::kLoss, -2},
+    {"k7/2Q5/1K6/8/8/8/8/8 b - - 0 1", Tablebases::kDraw, 0},
+};
+
+// Probes KRvK and KQvK when their .rtbw and .rtbz files are in pPath
+static int runTablebaseSuite(const std::string &pPath) {
+    Tablebases::init(pPath);
+    int failures = 0, probed = 0;
+    for (const auto &test : kTablebaseCases) {
+        Position position;
+        position.setFromFen(test.mFen);
+        int wdl, dtz;
+        if (!Tablebases::probeWdl(position, wdl) || !Tablebases::probeDtz(position, dtz)) {
+            continue;
+        }
+        probed++;
+        bool passed = wdl == test.mWdl && dtz == test.mDtz;
+        failures += passed ? 0 : 1;
+        std::printf("%-32s wdl %2d  dtz %3d  %s\n", test.mFen, wdl, dtz, passed ? "ok  " : "FAIL");
+    }
+    if (probed == 0) {
+        std::printf("no KRvK or KQvK tables in %s; tablebase checks skipped\n", pPath.c_str());
+    }
+    if (failures) {
+        std::printf("%d tablebase probe(s) FAILED\n", failures);
+    }
+    return failures;
+}
+
+static int runSuite(bool pBulk, const std::string &pTablebasePath) {
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &test : perftSuite()) {
+        Position position;
+        position.setFromFen(test.mFen);
+        auto caseStart = std::chrono::steady_clock::now();
+        uint64_t nodes = perft(position, test.mDepth, pBulk);
+        double seconds = elapsedSeconds(caseStart);
+        bool passed = nodes == test.mNodes;
+        failures += passed ? 0 : 1;
+        totalNodes += nodes;
+        std::printf("%-12s depth %d  %12llu  %s  %8.3f s  %12.0f nps\n", test.mName.c_str(),
+                    test.mDepth, static_cast<unsigned long long>(nodes), passed ? "ok  " : "FAIL",
+                    seconds, nodes / (seconds > 0 ? seconds : 1e-9));
+    }
+    double seconds = elapsedSeconds(start);
+    std::printf("\nNodes: %llu\nTime: %.3f s\nNPS: %.0f\n",
+                static_cast<unsigned long long>(totalNodes), seconds,
+                totalNodes / (seconds > 0 ? seconds : 1e-9));
+    if (failures) {
+        std::printf("%d position(s) FAILED\n", failures);
+    }
+    failures += runKeySuite();
+    failures += runTablebaseSuite(pTablebasePath);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    bool bulk = true;
+    bool suite = false;
+    int depth = -1;
+    std::string fen;
+    std::string tablebasePath = kDefaultTablebasePath;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--no-bulk")) {
+            bulk = false;
+        } else if (!std::strcmp(argv[i], "--syzygy") && i + 1 < argc) {
+            tablebasePath = argv[++i];
+        } else if (!std::strcmp(argv[i], "--suite")) {
+            suite = true;
+        } else if (!std::strcmp(argv[i], "--help") || !std::strcmp(argv[i], "-h")) {
+            std::fputs(kUsage, stdout);
+            return 0;
+        } else if (depth < 0) {
+            depth = std::atoi(argv[i]);
+        } else {
+            fen += (fen.empty() ? "" : " ") + std::string(argv[i]);
+        }
+    }
+
+    if (suite) {
+        return runSuite(bulk, tablebasePath);
+    }
+    if (depth < 1) {
+        std::fputs(kUsage, stderr);
+        return 2;
+    }
+
+    Position position;
+    if (fen.empty()) {
+        position.setStartPosition();
+    } else if (!position.setFromFen(fen)) {
+        std::fprintf(stderr, "invalid FEN: %s\n", fen.c_str());
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t total = 0;
+    for (const auto &entry : perftDivide(position, depth, bulk)) {
+        std::printf("%s: %llu\n", moveToUci(entry.mMove).c_str(),
+                    static_cast<unsigned long long>(entry.mNodes));
+        total += entry.mNodes;
+    }
+    double seconds = elapsedSeconds(start);
+    std::printf("\nNodes: %llu\nTime: %.3f s\nNPS: %.0f\n", static_cast<unsigned long long>(total),
+                seconds, total / (seconds > 0 ? seconds : 1e-9));
+    return 0;
+}
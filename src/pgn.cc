@@ -0,0 +1,503 @@
+#include "pgn.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bitboard.h"
+#include "move_list.h"
+#include "movegen.h"
+#include "position.h"
+
+// SAN piece letters by EPieceType (PAWN, ROOK, BISHOP, QUEEN, KING, KNIGHT)
+static const char kSanLetters[kPieceTypeCount] = {'P', 'R', 'B', 'Q', 'K', 'N'};
+
+static bool isSpace(char pChar) { return std::isspace(static_cast<unsigned char>(pChar)) != 0; }
+
+// Characters that end a movetext token. Unlike strchr, a string_view search
+// doesn't match a NUL byte against the terminator.
+static bool isTokenEnd(char pChar) {
+    return isSpace(pChar) || std::string_view("{}();[").find(pChar) != std::string_view::npos;
+}
+
+static bool isCastling(const PositionMove &pMove) {
+    return pMove.flag() == EMoveFlag::KING_CASTLE || pMove.flag() == EMoveFlag::QUEEN_CASTLE;
+}
+
+static bool sanPieceType(char pLetter, EPieceType &pType) {
+    for (int type = 0; type < kPieceTypeCount; type++) {
+        if (kSanLetters[type] == pLetter) {
+            pType = static_cast<EPieceType>(type);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string moveToSan(Position &pPosition, const PositionMove &pMove) {
+    std::string san;
+    if (pMove.flag() == EMoveFlag::KING_CASTLE) {
+        san = "O-O";
+    } else if (pMove.flag() == EMoveFlag::QUEEN_CASTLE) {
+        san = "O-O-O";
+    } else {
+        const EPieceType type = pieceType(pPosition.pieceAt(pMove.from()));
+        if (type == EPieceType::PAWN) {
+            if (pMove.isCapture()) {
+                san += static_cast<char>('a' + fileOf(pMove.from()));
+            }
+        } else {
+            san += kSanLetters[static_cast<int>(type)];
+            // Name the file, else the rank, else both, of a piece that could be
+            // confused with another of its kind reaching the same square
+            MoveList moves;
+            generateLegalMoves(pPosition, moves);
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for (auto &other : moves) {
+                if (other.to() != pMove.to() || other.from() == pMove.from() ||
+                    pieceType(pPosition.pieceAt(other.from())) != type || isCastling(other)) {
+                    continue;
+                }
+                ambiguous = true;
+                sameFile |= fileOf(other.from()) == fileOf(pMove.from());
+                sameRank |= rankOf(other.from()) == rankOf(pMove.from());
+            }
+            if (ambiguous && (!sameFile || sameRank)) {
+                san += static_cast<char>('a' + fileOf(pMove.from()));
+            }
+            if (ambiguous && sameFile) {
+                san += static_cast<char>('1' + rankOf(pMove.from()));
+            }
+        }
+        if (pMove.isCapture()) {
+            san += 'x';
+        }
+        san += squareName(pMove.to());
+        if (pMove.isPromotion()) {
+            san += '=';
+            san += kSanLetters[static_cast<int>(pMove.promotion())];
+        }
+    }
+
+    pPosition.makeMove(pMove);
+    if (pPosition.checkers()) {
+        MoveList replies;
+        generateLegalMoves(pPosition, replies);
+        san += replies.empty() ? '#' : '+';
+    }
+    pPosition.undoMove();
+    return san;
+}
+
+PositionMove parseSanMove(const Position &pPosition, std::string_view pSan) {
+    while (!pSan.empty() &&
+           std::string_view("+#!?").find(pSan.back()) != std::string_view::npos) {
+        pSan.remove_suffix(1);
+    }
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+
+    if (pSan == "O-O" || pSan == "0-0" || pSan == "O-O-O" || pSan == "0-0-0") {
+        EMoveFlag flag = pSan.size() == 3 ? EMoveFlag::KING_CASTLE : EMoveFlag::QUEEN_CASTLE;
+        for (auto &move : moves) {
+            if (move.flag() == flag) {
+                return move;
+            }
+        }
+        return PositionMove();
+    }
+
+    EPieceType type = EPieceType::PAWN;
+    if (!pSan.empty() && pSan[0] != 'P' && sanPieceType(pSan[0], type)) {
+        pSan.remove_prefix(1);
+    } else if (!pSan.empty() && pSan[0] == 'P') {
+        pSan.remove_prefix(1);
+    }
+    // Promotions are written e8=Q, and sometimes e8Q
+    EPieceType promotion = EPieceType::QUEEN;
+    bool hasPromotion = false;
+    if (type == EPieceType::PAWN && !pSan.empty() && sanPieceType(pSan.back(), promotion)) {
+        hasPromotion = true;
+        pSan.remove_suffix(1);
+        if (!pSan.empty() && pSan.back() == '=') {
+            pSan.remove_suffix(1);
+        }
+    }
+    if (pSan.size() < 2) {
+        return PositionMove();
+    }
+    const char toFile = pSan[pSan.size() - 2];
+    const char toRank = pSan[pSan.size() - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') {
+        return PositionMove();
+    }
+    const int to = makeSquare(toFile - 'a', toRank - '1');
+
+    int fromFile = -1, fromRank = -1;
+    for (char c : pSan.substr(0, pSan.size() - 2)) {
+        if (c >= 'a' && c <= 'h') {
+            fromFile = c - 'a';
+        } else if (c >= '1' && c <= '8') {
+            fromRank = c - '1';
+        } else if (c != 'x' && c != ':' && c != '-') {
+            return PositionMove();
+        }
+    }
+
+    PositionMove found;
+    for (auto &move : moves) {
+        if (move.to() != to || isCastling(move) ||
+            pieceType(pPosition.pieceAt(move.from())) != type ||
+            (fromFile >= 0 && fileOf(move.from()) != fromFile) ||
+            (fromRank >= 0 && rankOf(move.from()) != fromRank) ||
+            (move.isPromotion() && move.promotion() != promotion)) {
+            continue;
+        }
+        if (hasPromotion && !move.isPromotion()) {
+            continue;
+        }
+        if (!found.isNull()) {
+            // Ambiguous
+            return PositionMove();
+        }
+        found = move;
+    }
+    return found;
+}
+
+std::string_view PgnGameView::tag(std::string_view pName) const {
+    for (auto &tag : mTags) {
+        if (tag.mName == pName) {
+            return tag.mValue;
+        }
+    }
+    return {};
+}
+
+PgnReader::PgnReader(std::string_view pText)
+    : mText(pText)
+    , mPos(0) {}
+
+void PgnReader::skipSpace() {
+    while (mPos < mText.size()) {
+        if (isSpace(mText[mPos])) {
+            mPos++;
+        } else if (mText[mPos] == '%' && (mPos == 0 || mText[mPos - 1] == '\n')) {
+            // Escape line
+            size_t end = mText.find('\n', mPos);
+            mPos = end == std::string_view::npos ? mText.size() : end;
+        } else {
+            break;
+        }
+    }
+}
+
+bool PgnReader::readTag(PgnTag &pTag) {
+    // [Name "Value"], where the value may hold escaped quotes and brackets
+    mPos++;
+    size_t nameStart = mPos;
+    while (mPos < mText.size() && !isSpace(mText[mPos]) && mText[mPos] != '"' &&
+           mText[mPos] != ']') {
+        mPos++;
+    }
+    pTag.mName = mText.substr(nameStart, mPos - nameStart);
+    pTag.mValue = {};
+    while (mPos < mText.size() && isSpace(mText[mPos]) && mText[mPos] != '\n') {
+        mPos++;
+    }
+    if (mPos < mText.size() && mText[mPos] == '"') {
+        size_t valueStart = ++mPos;
+        while (mPos < mText.size() && mText[mPos] != '"' && mText[mPos] != '\n') {
+            mPos += mText[mPos] == '\\' ? 2 : 1;
+        }
+        mPos = std::min(mPos, mText.size());
+        pTag.mValue = mText.substr(valueStart, mPos - valueStart);
+    }
+    size_t close = mText.find_first_of("]\n", mPos);
+    mPos = close == std::string_view::npos ? mText.size() : close + 1;
+    return !pTag.mName.empty();
+}
+
+bool PgnReader::next(PgnGameView &pGame) {
+    pGame.mTags.clear();
+    pGame.mMoves.clear();
+    pGame.mResult = {};
+
+    skipSpace();
+    if (mPos >= mText.size()) {
+        return false;
+    }
+    while (mPos < mText.size() && mText[mPos] == '[') {
+        PgnTag tag;
+        if (readTag(tag)) {
+            pGame.mTags.push_back(tag);
+        }
+        skipSpace();
+    }
+
+    while (mPos < mText.size()) {
+        skipSpace();
+        if (mPos >= mText.size() || mText[mPos] == '[') {
+            // A game without a result token ends where the next one's tags begin
+            break;
+        }
+        const char c = mText[mPos];
+        if (c == '{') {
+            size_t end = mText.find('}', mPos);
+            mPos = end == std::string_view::npos ? mText.size() : end + 1;
+            continue;
+        }
+        if (c == ';') {
+            size_t end = mText.find('\n', mPos);
+            mPos = end == std::string_view::npos ? mText.size() : end;
+            continue;
+        }
+        if (c == '(') {
+            // Variations nest and may contain comments with parentheses
+            int depth = 0;
+            while (mPos < mText.size()) {
+                char v = mText[mPos];
+                if (v == '{') {
+                    size_t end = mText.find('}', mPos);
+                    mPos = end == std::string_view::npos ? mText.size() : end + 1;
+                    continue;
+                }
+                mPos++;
+                if (v == '(') {
+                    depth++;
+                } else if (v == ')' && --depth == 0) {
+                    break;
+                }
+            }
+            continue;
+        }
+        if (c == ')' || c == '}') {
+            mPos++;
+            continue;
+        }
+
+        size_t start = mPos;
+        while (mPos < mText.size() && !isTokenEnd(mText[mPos])) {
+            mPos++;
+        }
+        std::string_view token = mText.substr(start, mPos - start);
+        if (token.empty()) {
+            // Every delimiter is consumed above; still, never stall on one
+            mPos++;
+            continue;
+        }
+        if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+            pGame.mResult = token;
+            break;
+        }
+        if (token[0] == '$') {
+            continue;
+        }
+        // Move numbers, "12." and "12...", may run into the move itself
+        size_t digits = 0;
+        while (digits < token.size() && std::isdigit(static_cast<unsigned char>(token[digits]))) {
+            digits++;
+        }
+        size_t dots = digits;
+        while (dots < token.size() && token[dots] == '.') {
+            dots++;
+        }
+        if (dots > digits || digits == token.size()) {
+            token.remove_prefix(dots);
+        }
+        if (!token.empty()) {
+            pGame.mMoves.push_back(token);
+        }
+    }
+    return true;
+}
+
+// Offset of the first game starting at or after pFrom: a tag line preceded by
+// a blank line, which is where export-format PGN separates games
+static size_t nextGameStart(std::string_view pText, size_t pFrom) {
+    size_t pos = pFrom;
+    while ((pos = pText.find("\n[", pos)) != std::string_view::npos) {
+        size_t lineStart = pText.rfind('\n', pos == 0 ? 0 : pos - 1);
+        lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+        std::string_view previous = pText.substr(lineStart, pos - lineStart);
+        if (std::all_of(previous.begin(), previous.end(), isSpace)) {
+            return pos + 1;
+        }
+        pos++;
+    }
+    return pText.size();
+}
+
+size_t forEachPgnGame(std::string_view pText, int pThreads,
+                      const std::function<void(const PgnGameView &)> &pVisit) {
+    // Below this a slice isn't worth a thread
+    constexpr size_t kMinSliceBytes = 1 << 20;
+    const int threads =
+        std::max(1, std::min<int>(pThreads, static_cast<int>(pText.size() / kMinSliceBytes)));
+
+    std::vector<size_t> bounds = {0};
+    for (int i = 1; i < threads; i++) {
+        size_t start = nextGameStart(pText, std::max(bounds.back(), pText.size() / threads * i));
+        if (start > bounds.back() && start < pText.size()) {
+            bounds.push_back(start);
+        }
+    }
+    bounds.push_back(pText.size());
+
+    std::atomic<size_t> games(0);
+    auto parseSlice = [&](size_t pBegin, size_t pEnd) {
+        PgnReader reader(pText.substr(pBegin, pEnd - pBegin));
+        PgnGameView game;
+        size_t count = 0;
+        while (reader.next(game)) {
+            pVisit(game);
+            count++;
+        }
+        games += count;
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i + 1 < bounds.size(); i++) {
+        workers.emplace_back(parseSlice, bounds[i], bounds[i + 1]);
+    }
+    parseSlice(bounds[0], bounds[1]);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return games;
+}
+
+bool replayPgnGame(const PgnGameView &pGame, Position &pPosition,
+                   std::vector<PositionMove> &pMoves) {
+    pMoves.clear();
+    std::string_view fen = pGame.tag("FEN");
+    if (fen.empty()) {
+        pPosition.setStartPosition();
+    } else if (!pPosition.setFromFen(std::string(fen))) {
+        return false;
+    }
+    for (auto san : pGame.mMoves) {
+        PositionMove move = parseSanMove(pPosition, san);
+        if (move.isNull()) {
+            return false;
+        }
+        pMoves.push_back(move);
+        pPosition.makeMove(move);
+    }
+    return true;
+}
+
+static std::string escapeTagValue(const std::string &pValue) {
+    std::string escaped;
+    for (char c : pValue) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static std::string unescapeTagValue(std::string_view pValue) {
+    std::string value;
+    for (size_t i = 0; i < pValue.size(); i++) {
+        if (pValue[i] == '\\' && i + 1 < pValue.size()) {
+            i++;
+        }
+        value += pValue[i];
+    }
+    return value;
+}
+
+std::string writePgn(const PgnGame &pGame) {
+    static const std::pair<const char *, const char *> kRoster[] = {
+        {"Event", "?"}, {"Site", "?"},  {"Date", "????.??.??"}, {"Round", "?"},
+        {"White", "?"}, {"Black", "?"}, {"Result", nullptr}};
+    auto find = [&](const std::string &pName) -> const std::string * {
+        for (auto &tag : pGame.mTags) {
+            if (tag.first == pName) {
+                return &tag.second;
+            }
+        }
+        return nullptr;
+    };
+
+    std::string pgn;
+    auto writeTag = [&pgn](const std::string &pName, const std::string &pValue) {
+        pgn += "[" + pName + " \"" + escapeTagValue(pValue) + "\"]\n";
+    };
+    for (auto &roster : kRoster) {
+        const std::string *value = find(roster.first);
+        if (!roster.second) {
+            writeTag(roster.first, pGame.mResult);
+        } else {
+            writeTag(roster.first, value ? *value : roster.second);
+        }
+    }
+    const bool setUp = pGame.mStartFen != kStartFen;
+    for (auto &tag : pGame.mTags) {
+        bool inRoster = std::any_of(std::begin(kRoster), std::end(kRoster),
+                                    [&](const auto &pRoster) { return tag.first == pRoster.first; });
+        if (!inRoster && tag.first != "SetUp" && tag.first != "FEN") {
+            writeTag(tag.first, tag.second);
+        }
+    }
+    if (setUp) {
+        writeTag("SetUp", "1");
+        writeTag("FEN", pGame.mStartFen);
+    }
+    pgn += '\n';
+
+    // Move text, wrapped before a token would pass 80 columns
+    Position position;
+    position.setFromFen(pGame.mStartFen);
+    size_t lineLength = 0;
+    auto append = [&](const std::string &pToken) {
+        if (lineLength && lineLength + 1 + pToken.size() > 80) {
+            pgn += '\n';
+            lineLength = 0;
+        } else if (lineLength) {
+            pgn += ' ';
+            lineLength++;
+        }
+        pgn += pToken;
+        lineLength += pToken.size();
+    };
+    for (size_t i = 0; i < pGame.mMoves.size(); i++) {
+        const bool white = position.sideToMove() == EPieceColor::WHITE;
+        if (white || i == 0) {
+            append(std::to_string(position.fullmoveNumber()) + (white ? "." : "..."));
+        }
+        append(moveToSan(position, pGame.mMoves[i]));
+        position.makeMove(pGame.mMoves[i]);
+    }
+    append(pGame.mResult);
+    pgn += "\n\n";
+    return pgn;
+}
+
+bool readPgn(std::string_view pText, PgnGame &pGame) {
+    PgnReader reader(pText);
+    PgnGameView view;
+    if (!reader.next(view)) {
+        return false;
+    }
+    Position position;
+    std::vector<PositionMove> moves;
+    if (!replayPgnGame(view, position, moves)) {
+        return false;
+    }
+
+    pGame.mTags.clear();
+    for (auto &tag : view.mTags) {
+        pGame.mTags.emplace_back(std::string(tag.mName), unescapeTagValue(tag.mValue));
+    }
+    std::string_view fen = view.tag("FEN");
+    pGame.mStartFen = fen.empty() ? kStartFen : std::string(fen);
+    pGame.mMoves = std::move(moves);
+    pGame.mResult = view.mResult.empty() ? "*" : std::string(view.mResult);
+    return true;
+}
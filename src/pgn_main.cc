@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "pgn.h"
+#include "position.h"
+
+static const char *kUsage =
+    "usage: chess-pgn [options] <file.pgn>   parse and replay every game of a PGN file\n"
+    "options:\n"
+    "       --threads <n>   parse slices of the file in parallel (default: all cores)\n"
+    "       --no-replay     only tokenise, skipping SAN resolution\n";
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point pStart) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - pStart).count();
+}
+
+int main(int argc, char **argv) {
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    bool replay = true;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--no-replay")) {
+            replay = false;
+        } else if (!std::strcmp(argv[i], "--help") || !std::strcmp(argv[i], "-h")) {
+            std::fputs(kUsage, stdout);
+            return 0;
+        } else if (path.empty()) {
+            path = argv[i];
+        } else {
+            std::fputs(kUsage, stderr);
+            return 2;
+        }
+    }
+    if (path.empty()) {
+        std::fputs(kUsage, stderr);
+        return 2;
+    }
+
+    MappedFile file;
+    if (!file.open(path)) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 2;
+    }
+
+    std::atomic<size_t> plies(0), illegal(0);
+    auto start = std::chrono::steady_clock::now();
+    size_t games = forEachPgnGame(file.text(), threads, [&](const PgnGameView &pGame) {
+        if (!replay) {
+            plies += pGame.mMoves.size();
+            return;
+        }
+        // Each thread keeps its own position and move buffer across games
+        thread_local Position position;
+        thread_local std::vector<PositionMove> moves;
+        if (!replayPgnGame(pGame, position, moves)) {
+            illegal++;
+        }
+        plies += moves.size();
+    });
+    double seconds = elapsedSeconds(start);
+
+    std::printf("games %zu  plies %zu  illegal %zu\n", games, plies.load(), illegal.load());
+    std::printf("time %.3f s  %.0f games/s  %.1f MB/s\n", seconds,
+                seconds > 0 ? games / seconds : 0.0,
+                seconds > 0 ? file.size() / seconds / (1 << 20) : 0.0);
+    return illegal ? 1 : 0;
+}
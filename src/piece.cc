@@ -34,13 +34,15 @@ bool Piece::movedBefore() const { return mMovedBefore; }
 
 void Piece::setFirstMove() { mMovedBefore = true; }
 
-std::string Piece::getName() const {
+std::string Piece::getName() const { return name(mColor, mType); }
+
+std::string Piece::name(EPieceColor pColor, EPieceType pType) {
     std::string name = "";
-    switch (mColor) {
+    switch (pColor) {
         case EPieceColor::BLACK: name += "BLACK "; break;
         case EPieceColor::WHITE: name += "WHITE "; break;
     }
-    switch (mType) {
+    switch (pType) {
         case EPieceType::PAWN: name += "PAWN"; break;
         case EPieceType::ROOK: name += "ROOK"; break;
         case EPieceType::BISHOP: name += "BISHOP"; break;
@@ -0,0 +1,507 @@
+#include "position.h"
+
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "bitboard.h"
+#include "psqt.h"
+#include "zobrist.h"
+
+// Rights that survive a move touching the given square
+static int castlingMask(int pSquare) {
+    switch (pSquare) {
+        case 0: return kAllCastling & ~kWhiteQueenSide;
+        case 4: return kAllCastling & ~(kWhiteKingSide | kWhiteQueenSide);
+        case 7: return kAllCastling & ~kWhiteKingSide;
+        case 56: return kAllCastling & ~kBlackQueenSide;
+        case 60: return kAllCastling & ~(kBlackKingSide | kBlackQueenSide);
+        case 63: return kAllCastling & ~kBlackKingSide;
+        default: return kAllCastling;
+    }
+}
+
+Position::Position() {
+    AttackTables::init();
+    Zobrist::init();
+    PieceSquareTable::init();
+    clear();
+}
+
+void Position::clear() {
+    std::memset(mPieceBoards, 0, sizeof(mPieceBoards));
+    std::memset(mColorBoards, 0, sizeof(mColorBoards));
+    std::memset(mMailbox, kNoPiece, sizeof(mMailbox));
+    mSideToMove = EPieceColor::WHITE;
+    mFullmoveNumber = 1;
+    mPsqScore = ScorePair();
+    mGamePhase = 0;
+    mStates.reset();
+    mPly = 0;
+}
+
+void Position::setStartPosition() {
+    clear();
+    const EPieceType backRank[8] = {EPieceType::ROOK,  EPieceType::KNIGHT, EPieceType::BISHOP,
+                                    EPieceType::QUEEN, EPieceType::KING,   EPieceType::BISHOP,
+                                    EPieceType::KNIGHT, EPieceType::ROOK};
+    for (int file = 0; file < 8; file++) {
+        putPiece(makeSquare(file, 0), EPieceColor::WHITE, backRank[file]);
+        putPiece(makeSquare(file, 1), EPieceColor::WHITE, EPieceType::PAWN);
+        putPiece(makeSquare(file, 6), EPieceColor::BLACK, EPieceType::PAWN);
+        putPiece(makeSquare(file, 7), EPieceColor::BLACK, backRank[file]);
+    }
+    mStates[mPly].mCastlingRights = kAllCastling;
+    mStates[mPly].mKey = computeKey();
+    mStates[mPly].mCheckers = computeCheckers();
+}
+
+bool Position::setFromFen(const std::string &pFen) {
+    clear();
+    std::istringstream stream(pFen);
+    std::string board, side, castling, enPassant;
+    int halfmove = 0, fullmove = 1;
+    if (!(stream >> board >> side)) {
+        return false;
+    }
+    if (!(stream >> castling)) castling = "-";
+    if (!(stream >> enPassant)) enPassant = "-";
+    if (!(stream >> halfmove)) halfmove = 0;
+    if (!(stream >> fullmove)) fullmove = 1;
+
+    // Exactly eight ranks of exactly eight files
+    int file = 0, rank = 7;
+    for (char c : board) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) {
+                clear();
+                return false;
+            }
+            file = 0;
+            rank--;
+            continue;
+        }
+        if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > 8) {
+                clear();
+                return false;
+            }
+            continue;
+        }
+        EPieceColor color = std::isupper(static_cast<unsigned char>(c)) ? EPieceColor::WHITE
+                                                                         : EPieceColor::BLACK;
+        EPieceType type;
+        switch (std::tolower(static_cast<unsigned char>(c))) {
+            case 'p': type = EPieceType::PAWN; break;
+            case 'n': type = EPieceType::KNIGHT; break;
+            case 'b': type = EPieceType::BISHOP; break;
+            case 'r': type = EPieceType::ROOK; break;
+            case 'q': type = EPieceType::QUEEN; break;
+            case 'k': type = EPieceType::KING; break;
+            default: clear(); return false;
+        }
+        if (file > 7) {
+            clear();
+            return false;
+        }
+        putPiece(makeSquare(file, rank), color, type);
+        file++;
+    }
+
+    // Each side needs exactly one king
+    if (file != 8 || rank != 0 || (side != "w" && side != "b") ||
+        popCount(pieces(EPieceColor::WHITE, EPieceType::KING)) != 1 ||
+        popCount(pieces(EPieceColor::BLACK, EPieceType::KING)) != 1) {
+        clear();
+        return false;
+    }
+    mSideToMove = (side == "w") ? EPieceColor::WHITE : EPieceColor::BLACK;
+
+    for (char c : castling) {
+        switch (c) {
+            case 'K': mStates[mPly].mCastlingRights |= kWhiteKingSide; break;
+            case 'Q': mStates[mPly].mCastlingRights |= kWhiteQueenSide; break;
+            case 'k': mStates[mPly].mCastlingRights |= kBlackKingSide; break;
+            case 'q': mStates[mPly].mCastlingRights |= kBlackQueenSide; break;
+            default: break;
+        }
+    }
+    // A right only stands while its king and rook are still on their home squares
+    const struct {
+        int mRight;
+        EPieceColor mColor;
+        int mKing;
+        int mRook;
+    } kCastlingHomes[] = {{kWhiteKingSide, EPieceColor::WHITE, 4, 7},
+                          {kWhiteQueenSide, EPieceColor::WHITE, 4, 0},
+                          {kBlackKingSide, EPieceColor::BLACK, 60, 63},
+                          {kBlackQueenSide, EPieceColor::BLACK, 60, 56}};
+    for (auto &home : kCastlingHomes) {
+        if (mMailbox[home.mKing] != makePiece(home.mColor, EPieceType::KING) ||
+            mMailbox[home.mRook] != makePiece(home.mColor, EPieceType::ROOK)) {
+            mStates[mPly].mCastlingRights &= ~home.mRight;
+        }
+    }
+    // The square must lie behind a pawn that could just have made a double push
+    if (enPassant != "-") {
+        const EPieceColor us = mSideToMove;
+        const int square = parseSquare(enPassant);
+        const int forward = us == EPieceColor::WHITE ? 8 : -8;
+        if (square == kNoSquare || rankOf(square) != (us == EPieceColor::WHITE ? 5 : 2) ||
+            mMailbox[square - forward] != makePiece(~us, EPieceType::PAWN) ||
+            mMailbox[square] != kNoPiece || mMailbox[square + forward] != kNoPiece) {
+            clear();
+            return false;
+        }
+        // Kept only if a pawn can take there, as makeMove does, so a position has one key
+        if (AttackTables::pawnAttacks(~us, square) & pieces(us, EPieceType::PAWN)) {
+            mStates[mPly].mEnPassant = square;
+        }
+    }
+    // The side that just moved can't have left its king attacked
+    if (isInCheck(~mSideToMove)) {
+        clear();
+        return false;
+    }
+    mStates[mPly].mHalfmoveClock = halfmove;
+    mFullmoveNumber = fullmove;
+    mStates[mPly].mKey = computeKey();
+    mStates[mPly].mCheckers = computeCheckers();
+    return true;
+}
+
+std::string Position::toFen() const {
+    static const char kPieceLetters[kPieceTypeCount] = {'p', 'r', 'b', 'q', 'k', 'n'};
+    std::string fen;
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            PieceCode piece = mMailbox[makeSquare(file, rank)];
+            if (piece == kNoPiece) {
+                empty++;
+                continue;
+            }
+            if (empty) {
+                fen += static_cast<char>('0' + empty);
+                empty = 0;
+            }
+            char letter = kPieceLetters[static_cast<int>(pieceType(piece))];
+            fen += pieceColor(piece) == EPieceColor::WHITE ? static_cast<char>(std::toupper(letter))
+                                                           : letter;
+        }
+        if (empty) {
+            fen += static_cast<char>('0' + empty);
+        }
+        if (rank) {
+            fen += '/';
+        }
+    }
+
+    const PositionState &state = mStates[mPly];
+    fen += mSideToMove == EPieceColor::WHITE ? " w " : " b ";
+    std::string castling;
+    if (state.mCastlingRights & kWhiteKingSide) castling += 'K';
+    if (state.mCastlingRights & kWhiteQueenSide) castling += 'Q';
+    if (state.mCastlingRights & kBlackKingSide) castling += 'k';
+    if (state.mCastlingRights & kBlackQueenSide) castling += 'q';
+    fen += castling.empty() ? "-" : castling;
+    fen += ' ';
+    fen += state.mEnPassant == kNoSquare ? "-" : squareName(state.mEnPassant);
+    fen += ' ' + std::to_string(state.mHalfmoveClock) + ' ' + std::to_string(mFullmoveNumber);
+    return fen;
+}
+
+void Position::putPiece(int pSquare, EPieceColor pColor, EPieceType pType) {
+    Bitboard bit = squareBit(pSquare);
+    mPieceBoards[static_cast<int>(pColor)][static_cast<int>(pType)] |= bit;
+    mColorBoards[static_cast<int>(pColor)] |= bit;
+    PieceCode piece = makePiece(pColor, pType);
+    mMailbox[pSquare] = piece;
+    mStates[mPly].mKey ^= Zobrist::piece(piece, pSquare);
+    mPsqScore += PieceSquareTable::value(piece, pSquare);
+    mGamePhase += PieceSquareTable::phase(piece);
+}
+
+void Position::removePiece(int pSquare) {
+    PieceCode piece = mMailbox[pSquare];
+    if (piece == kNoPiece) {
+        return;
+    }
+    Bitboard bit = squareBit(pSquare);
+    int color = static_cast<int>(pieceColor(piece));
+    mPieceBoards[color][static_cast<int>(pieceType(piece))] &= ~bit;
+    mColorBoards[color] &= ~bit;
+    mMailbox[pSquare] = kNoPiece;
+    mStates[mPly].mKey ^= Zobrist::piece(piece, pSquare);
+    mPsqScore -= PieceSquareTable::value(piece, pSquare);
+    mGamePhase -= PieceSquareTable::phase(piece);
+}
+
+void Position::makeMove(const PositionMove &pMove) {
+    // Searches run on copies, whose headroom keeps this from reallocating
+    mStates.push();
+    mPly++;
+    PositionState &state = mStates[mPly];
+
+    const int from = pMove.from();
+    const int to = pMove.to();
+    const EPieceColor us = mSideToMove;
+    const PieceCode piece = mMailbox[from];
+    const EPieceType type = pieceType(piece);
+
+    state.mMove = pMove;
+    state.mCaptured = kNoPiece;
+    state.mKey ^=
+        Zobrist::enPassant(state.mEnPassant) ^ Zobrist::castling(state.mCastlingRights);
+    state.mEnPassant = kNoSquare;
+    state.mHalfmoveClock++;
+
+    if (pMove.flag() == EMoveFlag::EN_PASSANT) {
+        int capturedSquare = (us == EPieceColor::WHITE) ? to - 8 : to + 8;
+        state.mCaptured = mMailbox[capturedSquare];
+        removePiece(capturedSquare);
+    } else if (pMove.isCapture()) {
+        state.mCaptured = mMailbox[to];
+        removePiece(to);
+    }
+
+    removePiece(from);
+    putPiece(to, us, pMove.isPromotion() ? pMove.promotion() : type);
+
+    if (pMove.flag() == EMoveFlag::KING_CASTLE) {
+        removePiece(to + 1);
+        putPiece(to - 1, us, EPieceType::ROOK);
+    } else if (pMove.flag() == EMoveFlag::QUEEN_CASTLE) {
+        removePiece(to - 2);
+        putPiece(to + 1, us, EPieceType::ROOK);
+    } else if (pMove.flag() == EMoveFlag::DOUBLE_PUSH &&
+               (AttackTables::pawnAttacks(us, (from + to) / 2) &
+                pieces(~us, EPieceType::PAWN))) {
+        // Only a square some pawn can take on is kept, so transpositions share a key
+        state.mEnPassant = (from + to) / 2;
+    }
+
+    if (type == EPieceType::PAWN || state.mCaptured != kNoPiece) {
+        state.mHalfmoveClock = 0;
+    }
+    state.mCastlingRights &= castlingMask(from) & castlingMask(to);
+    state.mKey ^= Zobrist::enPassant(state.mEnPassant) ^
+                   Zobrist::castling(state.mCastlingRights) ^ Zobrist::side();
+
+    if (us == EPieceColor::BLACK) {
+        mFullmoveNumber++;
+    }
+    mSideToMove = ~us;
+    state.mCheckers = computeCheckers();
+}
+
+void Position::undoMove() {
+    const PositionMove move = mStates[mPly].mMove;
+    const PieceCode captured = mStates[mPly].mCaptured;
+    const int from = move.from();
+    const int to = move.to();
+
+    mSideToMove = ~mSideToMove;
+    const EPieceColor us = mSideToMove;
+    if (us == EPieceColor::BLACK) {
+        mFullmoveNumber--;
+    }
+
+    EPieceType type = move.isPromotion() ? EPieceType::PAWN : pieceType(mMailbox[to]);
+    removePiece(to);
+    putPiece(from, us, type);
+
+    if (move.flag() == EMoveFlag::KING_CASTLE) {
+        removePiece(to - 1);
+        putPiece(to + 1, us, EPieceType::ROOK);
+    } else if (move.flag() == EMoveFlag::QUEEN_CASTLE) {
+        removePiece(to + 1);
+        putPiece(to - 2, us, EPieceType::ROOK);
+    }
+
+    if (captured != kNoPiece) {
+        int capturedSquare = to;
+        if (move.flag() == EMoveFlag::EN_PASSANT) {
+            capturedSquare = (us == EPieceColor::WHITE) ? to - 8 : to + 8;
+        }
+        putPiece(capturedSquare, pieceColor(captured), pieceType(captured));
+    }
+
+    // Everything irreversible is already stored one ply down
+    mStates.pop();
+    mPly--;
+}
+
+void Position::makeNullMove() {
+    mStates.push();
+    mPly++;
+    PositionState &state = mStates[mPly];
+
+    state.mMove = PositionMove();
+    state.mCaptured = kNoPiece;
+    state.mKey ^= Zobrist::enPassant(state.mEnPassant) ^ Zobrist::side();
+    state.mEnPassant = kNoSquare;
+    state.mHalfmoveClock++;
+    mSideToMove = ~mSideToMove;
+    // Passing is only allowed out of check, and no piece moved to give one
+    state.mCheckers = 0;
+}
+
+void Position::undoNullMove() {
+    mSideToMove = ~mSideToMove;
+    mStates.pop();
+    mPly--;
+}
+
+bool Position::canUndo() const { return mPly > 0; }
+
+Bitboard Position::pieces(EPieceColor pColor, EPieceType pType) const {
+    return mPieceBoards[static_cast<int>(pColor)][static_cast<int>(pType)];
+}
+
+Bitboard Position::pieces(EPieceColor pColor) const {
+    return mColorBoards[static_cast<int>(pColor)];
+}
+
+Bitboard Position::occupied() const {
+    return mColorBoards[0] | mColorBoards[1];
+}
+
+PieceCode Position::pieceAt(int pSquare) const { return mMailbox[pSquare]; }
+
+PieceCode Position::capturedPiece(const PositionMove &pMove) const {
+    if (pMove.flag() == EMoveFlag::EN_PASSANT) {
+        return makePiece(~mSideToMove, EPieceType::PAWN);
+    }
+    return pMove.isCapture() ? mMailbox[pMove.to()] : kNoPiece;
+}
+
+int Position::kingSquare(EPieceColor pColor) const {
+    Bitboard king = pieces(pColor, EPieceType::KING);
+    return king ? lsb(king) : kNoSquare;
+}
+
+EPieceColor Position::sideToMove() const { return mSideToMove; }
+int Position::castlingRights() const { return mStates[mPly].mCastlingRights; }
+int Position::enPassantSquare() const { return mStates[mPly].mEnPassant; }
+int Position::halfmoveClock() const { return mStates[mPly].mHalfmoveClock; }
+int Position::fullmoveNumber() const { return mFullmoveNumber; }
+uint64_t Position::key() const { return mStates[mPly].mKey; }
+const ScorePair &Position::psqScore() const { return mPsqScore; }
+int Position::gamePhase() const { return mGamePhase; }
+
+void Position::setSideToMove(EPieceColor pColor) {
+    mSideToMove = pColor;
+    mStates[mPly].mKey = computeKey();
+    mStates[mPly].mCheckers = computeCheckers();
+}
+
+void Position::setCastlingRights(int pRights) {
+    mStates[mPly].mCastlingRights = pRights;
+    mStates[mPly].mKey = computeKey();
+    mStates[mPly].mCheckers = computeCheckers();
+}
+
+void Position::setEnPassantSquare(int pSquare) {
+    mStates[mPly].mEnPassant = pSquare;
+    mStates[mPly].mKey = computeKey();
+    mStates[mPly].mCheckers = computeCheckers();
+}
+
+void Position::setHalfmoveClock(int pClock) { mStates[mPly].mHalfmoveClock = pClock; }
+void Position::setFullmoveNumber(int pNumber) { mFullmoveNumber = pNumber; }
+
+uint64_t Position::computeKey() const {
+    uint64_t key = 0;
+    for (int sq = 0; sq < kSquareCount; sq++) {
+        if (mMailbox[sq] != kNoPiece) {
+            key ^= Zobrist::piece(mMailbox[sq], sq);
+        }
+    }
+    key ^= Zobrist::castling(mStates[mPly].mCastlingRights) ^ Zobrist::enPassant(mStates[mPly].mEnPassant);
+    if (mSideToMove == EPieceColor::BLACK) {
+        key ^= Zobrist::side();
+    }
+    return key;
+}
+
+Bitboard Position::attackersTo(int pSquare, Bitboard pOccupied) const {
+    auto both = [this](EPieceType pType) {
+        return pieces(EPieceColor::WHITE, pType) | pieces(EPieceColor::BLACK, pType);
+    };
+    const Bitboard queens = both(EPieceType::QUEEN);
+    // A pawn of one color attacks the square if a pawn of the other color there would attack it
+    return (AttackTables::pawnAttacks(EPieceColor::BLACK, pSquare) &
+            pieces(EPieceColor::WHITE, EPieceType::PAWN)) |
+           (AttackTables::pawnAttacks(EPieceColor::WHITE, pSquare) &
+            pieces(EPieceColor::BLACK, EPieceType::PAWN)) |
+           (AttackTables::knightAttacks(pSquare) & both(EPieceType::KNIGHT)) |
+           (AttackTables::kingAttacks(pSquare) & both(EPieceType::KING)) |
+           (AttackTables::bishopAttacks(pSquare, pOccupied) & (both(EPieceType::BISHOP) | queens)) |
+           (AttackTables::rookAttacks(pSquare, pOccupied) & (both(EPieceType::ROOK) | queens));
+}
+
+bool Position::isSquareAttacked(int pSquare, EPieceColor pByColor) const {
+    // Cheapest lookups first; sliders only need a ray when a slider exists at all
+    if (AttackTables::pawnAttacks(~pByColor, pSquare) & pieces(pByColor, EPieceType::PAWN)) {
+        return true;
+    }
+    if (AttackTables::knightAttacks(pSquare) & pieces(pByColor, EPieceType::KNIGHT)) {
+        return true;
+    }
+    if (AttackTables::kingAttacks(pSquare) & pieces(pByColor, EPieceType::KING)) {
+        return true;
+    }
+    const Bitboard queens = pieces(pByColor, EPieceType::QUEEN);
+    const Bitboard diagonals = pieces(pByColor, EPieceType::BISHOP) | queens;
+    if (diagonals && (AttackTables::bishopAttacks(pSquare, occupied()) & diagonals)) {
+        return true;
+    }
+    const Bitboard lines = pieces(pByColor, EPieceType::ROOK) | queens;
+    return lines && (AttackTables::rookAttacks(pSquare, occupied()) & lines);
+}
+
+Bitboard Position::checkers() const { return mStates[mPly].mCheckers; }
+
+bool Position::isInCheck(EPieceColor pColor) const {
+    if (pColor == mSideToMove) {
+        return mStates[mPly].mCheckers != 0;
+    }
+    int king = kingSquare(pColor);
+    return king != kNoSquare && isSquareAttacked(king, ~pColor);
+}
+
+Bitboard Position::computeCheckers() const {
+    int king = kingSquare(mSideToMove);
+    if (king == kNoSquare) {
+        return 0;
+    }
+    return attackersTo(king, occupied()) & pieces(~mSideToMove);
+}
+
+std::string squareName(int pSquare) {
+    return {static_cast<char>('a' + fileOf(pSquare)), static_cast<char>('1' + rankOf(pSquare))};
+}
+
+int parseSquare(const std::string &pName) {
+    if (pName.size() != 2 || pName[0] < 'a' || pName[0] > 'h' || pName[1] < '1' ||
+        pName[1] > '8') {
+        return kNoSquare;
+    }
+    return makeSquare(pName[0] - 'a', pName[1] - '1');
+}
+
+std::string moveToUci(const PositionMove &pMove) {
+    std::string uci = squareName(pMove.from()) + squareName(pMove.to());
+    if (pMove.isPromotion()) {
+        switch (pMove.promotion()) {
+            case EPieceType::KNIGHT: uci += 'n'; break;
+            case EPieceType::BISHOP: uci += 'b'; break;
+            case EPieceType::ROOK: uci += 'r'; break;
+            default: uci += 'q'; break;
+        }
+    }
+    return uci;
+}
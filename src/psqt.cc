@@ -0,0 +1,63 @@
+#include "psqt.h"
+
+#include <cstdlib>
+
+#include "bitboard.h"
+#include "evaluation.h"
+#include "types.h"
+
+ScorePair PieceSquareTable::mValues[kColorCount * kPieceTypeCount][kSquareCount];
+int PieceSquareTable::mPhases[kColorCount * kPieceTypeCount];
+
+// Bonus for a white piece; black pieces use the rank-mirrored square
+static ScorePair squareBonus(EPieceType pType, int pSquare) {
+    int rank = rankOf(pSquare);
+    int file = fileOf(pSquare);
+    ScorePair bonus;
+
+    // Pawn advancement bonus, worth more once the pieces are off the board
+    if (pType == EPieceType::PAWN) {
+        int advanced = rank - 1;
+        bonus.mMidgame = advanced * 10;
+        bonus.mEndgame = advanced * 20;
+    }
+
+    // Bonus for developed pieces
+    if (pType == EPieceType::KNIGHT || pType == EPieceType::BISHOP) {
+        int centerDistance = (std::abs(2 * file - 7) + std::abs(2 * rank - 7)) / 2;
+        bonus.mMidgame = (8 - centerDistance) * 5;
+        bonus.mEndgame = (8 - centerDistance) * 5;
+    }
+    return bonus;
+}
+
+static int phaseWeight(EPieceType pType) {
+    switch (pType) {
+        case EPieceType::KNIGHT:
+        case EPieceType::BISHOP: return 1;
+        case EPieceType::ROOK: return 2;
+        case EPieceType::QUEEN: return 4;
+        default: return 0;
+    }
+}
+
+void PieceSquareTable::init() {
+    static const bool sInitialized = [] {
+        for (int type = 0; type < kPieceTypeCount; type++) {
+            EPieceType pieceType = static_cast<EPieceType>(type);
+            PieceCode white = makePiece(EPieceColor::WHITE, pieceType);
+            PieceCode black = makePiece(EPieceColor::BLACK, pieceType);
+            for (int sq = 0; sq < kSquareCount; sq++) {
+                ScorePair value = squareBonus(pieceType, sq);
+                value.mMidgame += pieceValue(pieceType);
+                value.mEndgame += pieceValue(pieceType);
+                mValues[white][sq] = value;
+                // a1 <-> a8 mirror; black scores count against White
+                mValues[black][sq ^ 56] = {-value.mMidgame, -value.mEndgame};
+            }
+            mPhases[white] = mPhases[black] = phaseWeight(pieceType);
+        }
+        return true;
+    }();
+    (void)sInitialized;
+}
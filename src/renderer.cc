@@ -2,6 +2,7 @@
 
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Window/VideoMode.hpp>
@@ -47,6 +48,10 @@ void Renderer::drawBoard(Board::BoardPtr pBoard, bool pAnimating) {
     }
 
 #endif
+    drawSquares(mWindow, pBoard);
+}
+
+void Renderer::drawSquares(sf::RenderTarget& pTarget, Board::BoardPtr pBoard) {
     auto squares = pBoard->getSquares();
     sf::RectangleShape rect;
     rect.setSize(sf::Vector2f(100.f, 100.f));
@@ -73,10 +78,10 @@ void Renderer::drawBoard(Board::BoardPtr pBoard, bool pAnimating) {
                 rect.setSize(sf::Vector2f(100.f, 100.f));
                 rect.setOutlineThickness(0.f);
             }
-            mWindow.draw(rect);
+            pTarget.draw(rect);
             if (s->isOccupied()) {
                 s->getOccupier()->getSprite().setPosition(pos);
-                mWindow.draw(s->getOccupier()->getSprite());
+                pTarget.draw(s->getOccupier()->getSprite());
             }
         }
     }
@@ -0,0 +1,757 @@
+#include "search.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <thread>
+#include <vector>
+
+#include "evaluation.h"
+#include "move_list.h"
+#include "move_picker.h"
+#include "movegen.h"
+#include "position.h"
+#include "tablebase.h"
+#include "transposition_table.h"
+
+namespace {
+
+// Half-width of the first aspiration window, in centipawns
+constexpr int kAspirationWindow = 25;
+constexpr int kAspirationMinDepth = 4;
+constexpr int kNullMoveMinDepth = 3;
+// Late move reductions start from the third move, once two have been searched,
+// at this depth
+constexpr int kLmrMinMoves = 2;
+constexpr int kLmrMinDepth = 3;
+
+// Static evaluation from the side to move's point of view
+int staticEval(const Position &pPosition) {
+    int score = evaluate(pPosition);
+    return pPosition.sideToMove() == EPieceColor::WHITE ? score : -score;
+}
+
+// Mates and tablebase wins count plies from the root; every such score lies
+// past this bound, since no line is longer than 256 plies
+constexpr int kDistanceBound = Tablebases::kWinScore - 256;
+
+// Mates and tablebase wins are stored relative to the node rather than the
+// root, so an entry stays correct when the same position is reached at
+// another ply
+int scoreToTable(int pScore, int pPly) {
+    if (pScore >= kDistanceBound) return pScore + pPly;
+    if (pScore <= -kDistanceBound) return pScore - pPly;
+    return pScore;
+}
+
+int scoreFromTable(int pScore, int pPly) {
+    if (pScore >= kDistanceBound) return pScore - pPly;
+    if (pScore <= -kDistanceBound) return pScore + pPly;
+    return pScore;
+}
+
+// Grows with both depth and move number, logarithmically in each
+int lateMoveReduction(int pDepth, int pMoveNumber) {
+    static const auto kTable = [] {
+        std::array<std::array<int, 64>, Search::kMaxDepth + 1> table{};
+        for (int depth = 1; depth <= Search::kMaxDepth; depth++) {
+            for (int move = 1; move < 64; move++) {
+                table[depth][move] =
+                    static_cast<int>(0.75 + std::log(depth) * std::log(move) / 2.25);
+            }
+        }
+        return table;
+    }();
+    return kTable[std::min(pDepth, Search::kMaxDepth)][std::min(pMoveNumber, 63)];
+}
+
+}  // namespace
+
+void SearchStats::add(const SearchStats &pOther) {
+    mNodes += pOther.mNodes;
+    mQuiescenceNodes += pOther.mQuiescenceNodes;
+    mTableProbes += pOther.mTableProbes;
+    mTableHits += pOther.mTableHits;
+    mTableCutoffs += pOther.mTableCutoffs;
+    for (int i = 0; i < kCutoffBuckets; i++) {
+        mCutoffs[i] += pOther.mCutoffs[i];
+    }
+    mHashMoveRejects += pOther.mHashMoveRejects;
+    mDeltaPrunes += pOther.mDeltaPrunes;
+    mSeePrunes += pOther.mSeePrunes;
+}
+
+uint64_t SearchStats::cutoffs() const {
+    uint64_t total = 0;
+    for (uint64_t count : mCutoffs) {
+        total += count;
+    }
+    return total;
+}
+
+double SearchStats::firstMoveCutoffRate() const {
+    const uint64_t total = cutoffs();
+    return total ? static_cast<double>(mCutoffs[0]) / total : 0;
+}
+
+double SearchStats::effectiveBranchingFactor() const {
+    const size_t count = mIterations.size();
+    if (count < 2) {
+        return 0;
+    }
+    const uint64_t last = mIterations[count - 1].mNodes - mIterations[count - 2].mNodes;
+    const uint64_t previous =
+        mIterations[count - 2].mNodes - (count > 2 ? mIterations[count - 3].mNodes : 0);
+    return previous ? static_cast<double>(last) / previous : 0;
+}
+
+uint64_t nodesPerSecond(uint64_t pNodes, int64_t pTimeMs) {
+    return pNodes * 1000 / std::max<int64_t>(1, pTimeMs);
+}
+
+std::string searchStatsJson(const SearchResult &pResult) {
+    const SearchStats &stats = pResult.mStats;
+    char buffer[512];
+    std::snprintf(
+        buffer, sizeof(buffer),
+        "{\"depth\":%d,\"score\":%d,\"time_ms\":%lld,\"nodes\":%llu,\"qnodes\":%llu,"
+        "\"nps\":%llu,\"ebf\":%.2f,\"tt_probes\":%llu,\"tt_hits\":%llu,\"tt_cutoffs\":%llu,"
+        "\"first_move_cutoff_rate\":%.4f,\"hash_move_rejects\":%llu,\"delta_prunes\":%llu,"
+        "\"see_prunes\":%llu,\"cutoffs\":[",
+        pResult.mDepth, pResult.mScore, static_cast<long long>(pResult.mTimeMs),
+        static_cast<unsigned long long>(pResult.mNodes),
+        static_cast<unsigned long long>(stats.mQuiescenceNodes),
+        static_cast<unsigned long long>(nodesPerSecond(pResult.mNodes, pResult.mTimeMs)),
+        stats.effectiveBranchingFactor(), static_cast<unsigned long long>(stats.mTableProbes),
+        static_cast<unsigned long long>(stats.mTableHits),
+        static_cast<unsigned long long>(stats.mTableCutoffs), stats.firstMoveCutoffRate(),
+        static_cast<unsigned long long>(stats.mHashMoveRejects),
+        static_cast<unsigned long long>(stats.mDeltaPrunes),
+        static_cast<unsigned long long>(stats.mSeePrunes));
+    std::string json = buffer;
+    for (int i = 0; i < SearchStats::kCutoffBuckets; i++) {
+        json += (i ? "," : "") + std::to_string(stats.mCutoffs[i]);
+    }
+    json += "],\"iterations\":[";
+    for (size_t i = 0; i < stats.mIterations.size(); i++) {
+        const SearchIteration &iteration = stats.mIterations[i];
+        std::snprintf(buffer, sizeof(buffer), "%s{\"depth\":%d,\"nodes\":%llu,\"time_ms\":%lld}",
+                      i ? "," : "", iteration.mDepth,
+                      static_cast<unsigned long long>(iteration.mNodes),
+                      static_cast<long long>(iteration.mTimeMs));
+        json += buffer;
+    }
+    return json + "]}";
+}
+
+Search::Search(TranspositionTable &pTable, int pThreads, const SearchOptions &pOptions)
+    : mTable(pTable)
+    , mThreadCount(std::clamp(pThreads, 1, kMaxThreads))
+    , mOptions(pOptions)
+    , mStart(std::chrono::steady_clock::now())
+    , mStopped(false) {}
+
+SearchResult Search::run(const Position &pPosition, const SearchLimits &pLimits) {
+    mLimits = pLimits;
+    mTable.newSearch();
+
+    // Positions in the tablebases need no search at all
+    SearchResult tablebaseResult;
+    Position root = pPosition;
+    if (Tablebases::probeRoot(root, tablebaseResult.mTiedMoves, tablebaseResult.mScore) &&
+        !tablebaseResult.mTiedMoves.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mProgressMutex);
+            mStart = std::chrono::steady_clock::now();
+            mProgress = SearchProgress();
+            mIterations.clear();
+            mWorkers.clear();
+        }
+        tablebaseResult.mBestMove = tablebaseResult.mTiedMoves.front();
+        tablebaseResult.mPrincipalVariation = {tablebaseResult.mBestMove};
+        tablebaseResult.mDepth = 1;
+        reportIteration(tablebaseResult);
+        tablebaseResult.mTimeMs = elapsedMs();
+        tablebaseResult.mStats = stats();
+        mStopped = false;
+        return tablebaseResult;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mProgressMutex);
+        mStart = std::chrono::steady_clock::now();
+        mProgress = SearchProgress();
+        mIterations.clear();
+        mWorkers.clear();
+        for (int i = 0; i < mThreadCount; i++) {
+            mWorkers.push_back(std::make_unique<SearchWorker>(*this, i));
+        }
+    }
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < mThreadCount; i++) {
+        helpers.emplace_back(&SearchWorker::run, mWorkers[i].get(), std::cref(pPosition));
+    }
+    mWorkers[0]->run(pPosition);
+    // Helpers never outlive the main worker's decision to stop
+    mStopped = true;
+    for (auto &helper : helpers) {
+        helper.join();
+    }
+
+    SearchResult result = selectBestResult();
+    result.mNodes = nodes();
+    result.mTimeMs = elapsedMs();
+    result.mStats = stats();
+    // Ready for the next run
+    mStopped = false;
+    return result;
+}
+
+void Search::stop() { mStopped = true; }
+
+SearchProgress Search::progress() const {
+    std::lock_guard<std::mutex> lock(mProgressMutex);
+    SearchProgress progress = mProgress;
+    progress.mNodes = nodes();
+    progress.mTimeMs = elapsedMs();
+    progress.mStats = collectStats();
+    return progress;
+}
+
+SearchStats Search::stats() const {
+    std::lock_guard<std::mutex> lock(mProgressMutex);
+    return collectStats();
+}
+
+SearchStats Search::collectStats() const {
+    SearchStats stats;
+    for (auto &worker : mWorkers) {
+        worker->addStats(stats);
+    }
+    stats.mNodes = nodes();
+    stats.mIterations = mIterations;
+    return stats;
+}
+
+void Search::setIterationCallback(IterationCallback pCallback) {
+    mIterationCallback = std::move(pCallback);
+}
+
+void Search::reportIteration(const SearchResult &pResult) {
+    {
+        std::lock_guard<std::mutex> lock(mProgressMutex);
+        mProgress.mBestMove = pResult.mBestMove;
+        mProgress.mScore = pResult.mScore;
+        mProgress.mDepth = pResult.mDepth;
+        mIterations.push_back({pResult.mDepth, nodes(), elapsedMs()});
+    }
+    if (mIterationCallback) {
+        SearchResult result = pResult;
+        result.mNodes = nodes();
+        result.mTimeMs = elapsedMs();
+        result.mStats = stats();
+        mIterationCallback(result);
+    }
+}
+
+uint64_t Search::nodes() const {
+    uint64_t total = 0;
+    for (auto &worker : mWorkers) {
+        total += worker->nodes();
+    }
+    return total;
+}
+
+int64_t Search::elapsedMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - mStart)
+        .count();
+}
+
+SearchResult Search::selectBestResult() const {
+    // Each finished thread votes for its best move, weighted by depth and by
+    // how far its score lies above the worst score reported
+    int minScore = kInfinity;
+    for (auto &worker : mWorkers) {
+        if (worker->result().mDepth > 0) {
+            minScore = std::min(minScore, worker->result().mScore);
+        }
+    }
+    std::map<uint16_t, int64_t> votes;
+    auto keyOf = [](const PositionMove &pMove) { return pMove.raw(); };
+    for (auto &worker : mWorkers) {
+        const SearchResult &result = worker->result();
+        if (result.mDepth > 0) {
+            votes[keyOf(result.mBestMove)] +=
+                int64_t(result.mScore - minScore + 14) * result.mDepth;
+        }
+    }
+
+    const SearchWorker *best = mWorkers[0].get();
+    for (auto &worker : mWorkers) {
+        const SearchResult &result = worker->result();
+        const SearchResult &bestResult = best->result();
+        if (result.mDepth == 0) {
+            continue;
+        }
+        int64_t vote = votes[keyOf(result.mBestMove)];
+        int64_t bestVote = bestResult.mDepth ? votes[keyOf(bestResult.mBestMove)] : -1;
+        if (vote > bestVote || (vote == bestVote && result.mDepth > bestResult.mDepth)) {
+            best = worker.get();
+        }
+    }
+    return best->result();
+}
+
+SearchWorker::SearchWorker(Search &pSearch, int pId)
+    : mSearch(pSearch)
+    , mId(pId)
+    , mNodes(0)
+    , mFollowPv(false)
+    , mRootDepth(0) {
+    mHistory.clear();
+}
+
+const SearchResult &SearchWorker::result() const { return mResult; }
+
+uint64_t SearchWorker::nodes() const { return mNodes.load(std::memory_order_relaxed); }
+
+void SearchWorker::addStats(SearchStats &pStats) const {
+    auto load = [](const std::atomic<uint64_t> &pCounter) {
+        return pCounter.load(std::memory_order_relaxed);
+    };
+    pStats.mQuiescenceNodes += load(mStats.mQuiescenceNodes);
+    pStats.mTableProbes += load(mStats.mTableProbes);
+    pStats.mTableHits += load(mStats.mTableHits);
+    pStats.mTableCutoffs += load(mStats.mTableCutoffs);
+    for (int i = 0; i < SearchStats::kCutoffBuckets; i++) {
+        pStats.mCutoffs[i] += load(mStats.mCutoffs[i]);
+    }
+    pStats.mHashMoveRejects += load(mStats.mHashMoveRejects);
+    pStats.mDeltaPrunes += load(mStats.mDeltaPrunes);
+    pStats.mSeePrunes += load(mStats.mSeePrunes);
+}
+
+bool SearchWorker::isMainThread() const { return mId == 0; }
+
+void SearchWorker::run(const Position &pRoot) {
+    mPosition = pRoot;
+    mResult = SearchResult();
+
+    MoveList moves;
+    generateLegalMoves(mPosition, moves);
+    mRootMoves.clear();
+    for (auto &move : moves) {
+        mRootMoves.push_back({move, -kInfinity});
+    }
+    if (mRootMoves.empty()) {
+        // Nothing to search, but mate and stalemate must not look alike
+        mResult.mScore = mPosition.checkers() ? -kMateScore : 0;
+        return;
+    }
+    // Something legal can always be played, even if the first iteration is cut short
+    mResult.mBestMove = mRootMoves[0].mMove;
+    mResult.mTiedMoves = {mResult.mBestMove};
+
+    // Odd helpers start one ply deeper so the threads spread over two depths
+    int maxDepth = std::min(mSearch.mLimits.mMaxDepth, Search::kMaxDepth);
+    int startDepth = isMainThread() ? 1 : 1 + (mId & 1);
+    for (int depth = std::min(startDepth, maxDepth); depth <= maxDepth; depth++) {
+        if (!searchRoot(depth)) {
+            break;
+        }
+        mPreviousPv = mResult.mPrincipalVariation;
+        if (!isMainThread()) {
+            continue;
+        }
+        mSearch.reportIteration(mResult);
+        if (mSearch.mLimits.mSoftTimeMs && mSearch.elapsedMs() >= mSearch.mLimits.mSoftTimeMs) {
+            break;
+        }
+    }
+}
+
+bool SearchWorker::searchRoot(int pDepth) {
+    mRootDepth = pDepth;
+    const SearchOptions &options = mSearch.mOptions;
+    // Later iterations rarely move far from the last score, so they start with a
+    // narrow window around it and widen it only when the score falls outside
+    int delta = kAspirationWindow;
+    int alpha = -kInfinity;
+    int beta = kInfinity;
+    if (options.mAspirationWindows && pDepth >= kAspirationMinDepth && mResult.mDepth > 0 &&
+        std::abs(mResult.mScore) < kMateBound) {
+        alpha = std::max(mResult.mScore - delta, -kInfinity);
+        beta = std::min(mResult.mScore + delta, kInfinity);
+    }
+
+    MoveList tied;
+    int score;
+    while (true) {
+        score = searchRootMoves(pDepth, alpha, beta, tied);
+        if (mSearch.mStopped) {
+            // A partial iteration is discarded in favour of the last complete one
+            return false;
+        }
+        if (score <= alpha && alpha > -kInfinity) {
+            alpha = std::max(score - delta, -kInfinity);
+        } else if (score >= beta && beta < kInfinity) {
+            beta = std::min(score + delta, kInfinity);
+        } else {
+            break;
+        }
+        delta *= 2;
+    }
+
+    mResult.mBestMove = tied[0];
+    // Reusing the vectors' capacity keeps later iterations off the heap
+    mResult.mTiedMoves.assign(tied.begin(), tied.end());
+    mResult.mScore = score;
+    mResult.mDepth = pDepth;
+    mResult.mPrincipalVariation.clear();
+    extractPrincipalVariation(tied[0], pDepth, mResult.mPrincipalVariation);
+    return true;
+}
+
+int SearchWorker::searchRootMoves(int pDepth, int pAlpha, int pBeta, MoveList &pTied) {
+    const SearchOptions &options = mSearch.mOptions;
+
+    // Previous iteration's best move first, the rest by their last scores
+    std::stable_sort(mRootMoves.begin(), mRootMoves.end(),
+                     [](const RootMove &m1, const RootMove &m2) { return m1.mScore > m2.mScore; });
+
+    int bestScore = -kInfinity;
+    pTied.clear();
+    for (size_t i = 0; i < mRootMoves.size(); i++) {
+        RootMove &root = mRootMoves[i];
+        const PositionMove &move = root.mMove;
+
+        mFollowPv = i == 0 && !mPreviousPv.empty() && mPreviousPv[0] == move;
+        countNode();
+        mPosition.makeMove(move);
+        const int depth = pDepth - 1 + (options.mCheckExtensions && mPosition.checkers() ? 1 : 0);
+        int score;
+        if (i == 0) {
+            score = -negamax(depth, 1, -pBeta, -pAlpha, true);
+        } else {
+            // Moves scoring level with the best are kept as ties, so the bound
+            // they must beat sits one below it
+            int alpha = std::max(pAlpha, bestScore - 1);
+            if (options.mPrincipalVariationSearch) {
+                score = -negamax(depth, 1, -alpha - 1, -alpha, true);
+                if (score > alpha && score < pBeta) {
+                    score = -negamax(depth, 1, -pBeta, -alpha, true);
+                }
+            } else {
+                score = -negamax(depth, 1, -pBeta, -alpha, true);
+            }
+        }
+        mPosition.undoMove();
+        if (mSearch.mStopped) {
+            return 0;
+        }
+        root.mScore = score;
+
+        if (score > bestScore) {
+            pTied.clear();
+            pTied.push_back(move);
+            bestScore = score;
+        } else if (score == bestScore) {
+            pTied.push_back(move);
+        }
+        if (bestScore >= pBeta) {
+            break;
+        }
+    }
+    return bestScore;
+}
+
+int SearchWorker::negamax(int pDepth, int pPly, int pAlpha, int pBeta, bool pAllowNull) {
+    const SearchOptions &options = mSearch.mOptions;
+
+    if (shouldStop()) {
+        return 0;
+    }
+    if (pDepth <= 0) {
+        return quiescence(pPly, pAlpha, pBeta);
+    }
+    if (pPly >= kMaxPly) {
+        return staticEval(mPosition);
+    }
+    // Tablebase results hold with the fifty-move counter just reset
+    int wdl;
+    if (mPosition.halfmoveClock() == 0 &&
+        popCount(mPosition.occupied()) <= Tablebases::maxPieces() &&
+        Tablebases::probeWdl(mPosition, wdl)) {
+        // Cursed wins and blessed losses are drawn by the fifty-move rule
+        return wdl == Tablebases::kWin    ? Tablebases::kWinScore - pPly
+               : wdl == Tablebases::kLoss ? -Tablebases::kWinScore + pPly
+                                          : 0;
+    }
+
+    const bool isPvNode = pBeta - pAlpha > 1;
+    const int alphaOrig = pAlpha;
+    const uint64_t key = mPosition.key();
+    PositionMove hashMove;
+    TTEntry entry;
+    increment(mStats.mTableProbes);
+    if (mSearch.mTable.probe(key, entry)) {
+        increment(mStats.mTableHits);
+        hashMove = entry.mMove;
+        int score = scoreFromTable(entry.mScore, pPly);
+        if (entry.mDepth >= pDepth && !mFollowPv &&
+            (entry.mBound == EBound::EXACT || (entry.mBound == EBound::LOWER && score >= pBeta) ||
+             (entry.mBound == EBound::UPPER && score <= pAlpha))) {
+            increment(mStats.mTableCutoffs);
+            return score;
+        }
+    }
+
+    const EPieceColor us = mPosition.sideToMove();
+    const bool inCheck = mPosition.checkers() != 0;
+
+    // Null move: if passing still leaves us above beta, a real move would too.
+    // Positions with only pawns left are prone to zugzwang, where passing would
+    // be the best move if it were legal, so they are not pruned this way.
+    const Bitboard nonPawnMaterial =
+        mPosition.pieces(us) ^ mPosition.pieces(us, EPieceType::PAWN) ^
+        mPosition.pieces(us, EPieceType::KING);
+    if (options.mNullMovePruning && pAllowNull && !isPvNode && !inCheck &&
+        pDepth >= kNullMoveMinDepth && nonPawnMaterial && staticEval(mPosition) >= pBeta) {
+        const int reduction = 3 + pDepth / 6;
+        mPosition.makeNullMove();
+        int score = -negamax(pDepth - 1 - reduction, pPly + 1, -pBeta, -pBeta + 1, false);
+        mPosition.undoNullMove();
+        if (mSearch.mStopped) {
+            return 0;
+        }
+        if (score >= pBeta) {
+            // Unproven mates from a null move search are not trusted
+            return score >= kMateBound ? pBeta : score;
+        }
+    }
+
+    // While still on the previous PV its move goes first instead of the hash move
+    const bool onPv = mFollowPv && pPly < static_cast<int>(mPreviousPv.size());
+    MovePicker picker(mPosition, onPv ? mPreviousPv[pPly] : hashMove, mKillers[pPly], mHistory);
+    mFollowPv = onPv && picker.hasHashMove();
+    if (!onPv && !hashMove.isNull() && !picker.hasHashMove()) {
+        increment(mStats.mHashMoveRejects);
+    }
+
+    PositionMove bestMove;
+    PositionMove move;
+    MoveList quietsTried;
+    int bestScore = -kInfinity;
+    int movesSearched = 0;
+    while (picker.next(move)) {
+        const bool isQuiet = !move.isCapture() && !move.isPromotion();
+        const bool isKiller = move == mKillers[pPly][0] || move == mKillers[pPly][1];
+        countNode();
+        mPosition.makeMove(move);
+        const bool givesCheck = mPosition.checkers() != 0;
+        // Checks stop being extended once the line is twice the iteration's
+        // depth, so long checking sequences can't run the search away
+        const bool extend = options.mCheckExtensions && givesCheck && pPly < 2 * mRootDepth;
+        const int depth = pDepth - 1 + (extend ? 1 : 0);
+
+        int score;
+        if (movesSearched == 0) {
+            score = -negamax(depth, pPly + 1, -pBeta, -pAlpha, true);
+        } else {
+            // Late quiet moves are searched shallower first; a move that beats
+            // alpha anyway earns a full-depth search
+            int reduction = 0;
+            if (options.mLateMoveReductions && pDepth >= kLmrMinDepth &&
+                movesSearched >= kLmrMinMoves && isQuiet && !isKiller && !inCheck &&
+                !givesCheck) {
+                reduction = std::min(lateMoveReduction(pDepth, movesSearched), depth - 1);
+            }
+            if (options.mPrincipalVariationSearch) {
+                // Every move after the first is expected to fail low, which a
+                // null window proves more cheaply
+                score = -negamax(depth - reduction, pPly + 1, -pAlpha - 1, -pAlpha, true);
+                if (score > pAlpha && reduction > 0) {
+                    score = -negamax(depth, pPly + 1, -pAlpha - 1, -pAlpha, true);
+                }
+                if (score > pAlpha && score < pBeta) {
+                    score = -negamax(depth, pPly + 1, -pBeta, -pAlpha, true);
+                }
+            } else {
+                score = -negamax(depth - reduction, pPly + 1, -pBeta, -pAlpha, true);
+                if (score > pAlpha && reduction > 0) {
+                    score = -negamax(depth, pPly + 1, -pBeta, -pAlpha, true);
+                }
+            }
+        }
+        mPosition.undoMove();
+        // Only the first move searched at each ply continues the previous PV
+        mFollowPv = false;
+        if (mSearch.mStopped) {
+            return 0;
+        }
+        movesSearched++;
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+        }
+        if (score > pAlpha) {
+            pAlpha = score;
+        }
+        if (pAlpha >= pBeta) {
+            increment(mStats.mCutoffs[std::min(movesSearched, SearchStats::kCutoffBuckets) - 1]);
+            if (isQuiet) {
+                updateQuietStats(move, quietsTried, pDepth, pPly);
+            }
+            break;
+        }
+        if (isQuiet) {
+            quietsTried.push_back(move);
+        }
+    }
+    if (movesSearched == 0) {
+        // Mate scores count the plies from the root, so shorter mates rank higher
+        bestScore = inCheck ? -kMateScore + pPly : 0;
+    }
+
+    EBound bound = EBound::EXACT;
+    if (bestScore <= alphaOrig) {
+        bound = EBound::UPPER;
+    } else if (bestScore >= pBeta) {
+        bound = EBound::LOWER;
+    }
+    mSearch.mTable.store(key, pDepth, scoreToTable(bestScore, pPly), bound, bestMove);
+    return bestScore;
+}
+
+int SearchWorker::quiescence(int pPly, int pAlpha, int pBeta) {
+    // Margin for positional gains a capture may bring beyond the material it wins
+    constexpr int kDeltaMargin = 200;
+
+    if (shouldStop()) {
+        return 0;
+    }
+    // The previous PV ends at the horizon
+    mFollowPv = false;
+    if (pPly >= kMaxPly) {
+        return staticEval(mPosition);
+    }
+    const bool inCheck = mPosition.checkers() != 0;
+    // Standing pat is no option in check
+    int bestScore = -kMateScore + pPly;
+    int standPat = 0;
+    if (!inCheck) {
+        // The side to move can usually do at least as well as the static score
+        // by declining every capture
+        standPat = staticEval(mPosition);
+        if (standPat >= pBeta) {
+            return standPat;
+        }
+        pAlpha = std::max(pAlpha, standPat);
+        bestScore = standPat;
+    }
+
+    // Captures only, or every evasion when in check
+    MovePicker picker(mPosition, mHistory);
+    PositionMove move;
+    while (picker.next(move)) {
+        if (!inCheck) {
+            // Delta pruning: skip captures that can't lift the score back to the
+            // window even if the captured material is won outright
+            PieceCode captured = mPosition.capturedPiece(move);
+            int gain = captured == kNoPiece ? 0 : pieceValue(pieceType(captured));
+            if (move.isPromotion()) {
+                gain += pieceValue(move.promotion()) - pieceValue(EPieceType::PAWN);
+            }
+            if (standPat + gain + kDeltaMargin <= pAlpha) {
+                increment(mStats.mDeltaPrunes);
+                continue;
+            }
+            // Captures that lose material in the exchange are left alone
+            if (staticExchange(mPosition, move) < 0) {
+                increment(mStats.mSeePrunes);
+                continue;
+            }
+        }
+        countNode();
+        increment(mStats.mQuiescenceNodes);
+        mPosition.makeMove(move);
+        int score = -quiescence(pPly + 1, -pBeta, -pAlpha);
+        mPosition.undoMove();
+        if (mSearch.mStopped) {
+            return 0;
+        }
+
+        bestScore = std::max(bestScore, score);
+        pAlpha = std::max(pAlpha, score);
+        if (pAlpha >= pBeta) break;
+    }
+    return bestScore;
+}
+
+void SearchWorker::updateQuietStats(const PositionMove &pMove, const MoveList &pQuietsTried,
+                                    int pDepth, int pPly) {
+    PositionMove *killers = mKillers[pPly];
+    if (killers[0] != pMove) {
+        killers[1] = killers[0];
+        killers[0] = pMove;
+    }
+    // Deeper cutoffs say more about a move; the quiets tried before it failed to cut
+    const EPieceColor us = mPosition.sideToMove();
+    const int bonus = pDepth * pDepth;
+    mHistory.update(us, pMove, bonus);
+    for (auto &quiet : pQuietsTried) {
+        mHistory.update(us, quiet, -bonus);
+    }
+}
+
+void SearchWorker::countNode() { increment(mNodes); }
+
+void SearchWorker::increment(std::atomic<uint64_t> &pCounter) {
+    // Only the owning thread writes a counter, so a relaxed load and store suffice
+    pCounter.store(pCounter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+bool SearchWorker::shouldStop() {
+    if (mSearch.mStopped.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    // Only the main thread watches the limits; checking the clock is comparatively
+    // expensive, so it is only done every 1024 nodes
+    if (isMainThread() && (nodes() & 1023) == 0) {
+        const SearchLimits &limits = mSearch.mLimits;
+        if ((limits.mHardTimeMs && mSearch.elapsedMs() >= limits.mHardTimeMs) ||
+            (limits.mMaxNodes && mSearch.nodes() >= limits.mMaxNodes)) {
+            mSearch.stop();
+        }
+    }
+    return mSearch.mStopped.load(std::memory_order_relaxed);
+}
+
+void SearchWorker::extractPrincipalVariation(const PositionMove &pBestMove, int pDepth,
+                                             std::vector<PositionMove> &pLine) {
+    pLine.push_back(pBestMove);
+    mPosition.makeMove(pBestMove);
+    // Follow stored best moves, checking each one is legal in the reached position
+    TTEntry entry;
+    while (static_cast<int>(pLine.size()) < pDepth &&
+           mSearch.mTable.probe(mPosition.key(), entry) && !entry.mMove.isNull()) {
+        MoveList legal;
+        generateLegalMoves(mPosition, legal);
+        if (std::find(legal.begin(), legal.end(), entry.mMove) == legal.end()) {
+            break;
+        }
+        pLine.push_back(entry.mMove);
+        mPosition.makeMove(entry.mMove);
+    }
+    for (size_t i = 0; i < pLine.size(); i++) {
+        mPosition.undoMove();
+    }
+}
@@ -0,0 +1,60 @@
+#include "search_job.h"
+
+#include <memory>
+#include <thread>
+
+#include "position.h"
+#include "search.h"
+#include "transposition_table.h"
+
+SearchJob::SearchJob(TranspositionTable &pTable)
+    : mTable(pTable)
+    , mFinished(false) {}
+
+SearchJob::~SearchJob() { cancel(); }
+
+void SearchJob::start(const Position &pPosition, const SearchLimits &pLimits, int pThreads,
+                      const SearchOptions &pOptions) {
+    cancel();
+    mPosition = pPosition;
+    mFinished = false;
+    mSearch = std::make_unique<Search>(mTable, pThreads, pOptions);
+    mThread = std::thread([this, pLimits] {
+        mResult = mSearch->run(mPosition, pLimits);
+        mFinished = true;
+    });
+}
+
+bool SearchJob::isRunning() const { return mThread.joinable(); }
+
+bool SearchJob::takeResult(SearchResult &pResult) {
+    if (!mThread.joinable() || !mFinished) {
+        return false;
+    }
+    mThread.join();
+    pResult = std::move(mResult);
+    mSearch.reset();
+    return true;
+}
+
+void SearchJob::stop() {
+    if (mThread.joinable()) {
+        mSearch->stop();
+    }
+}
+
+void SearchJob::cancel() {
+    if (!mThread.joinable()) {
+        return;
+    }
+    mSearch->stop();
+    mThread.join();
+    mSearch.reset();
+}
+
+SearchProgress SearchJob::progress() const {
+    if (!mThread.joinable()) {
+        return SearchProgress();
+    }
+    return mSearch->progress();
+}
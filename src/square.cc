@@ -16,6 +16,8 @@ Square::Square(int pX, int pY, EPieceColor pColor)
 
 int Square::getX() const { return mX; }
 int Square::getY() const { return mY; }
+// Board rows grow downwards from Black's back rank, position ranks grow from White's
+int Square::getIndex() const { return (7 - mY) * 8 + mX; }
 
 bool Square::isOccupied() const {
     // std::cout << "Occupied" << std::endl;
@@ -0,0 +1,1017 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bitboard.h"
+#include "mapped_file.h"
+#include "move_list.h"
+#include "movegen.h"
+#include "position.h"
+
+namespace {
+
+constexpr int kMaxTablePieces = 7;
+// Root moves are ranked from this down, by their distance to zeroing
+constexpr int kMaxDtz = 1 << 18;
+#ifdef _WIN32
+constexpr char kPathSeparator = ';';
+#else
+constexpr char kPathSeparator = ':';
+#endif
+
+constexpr uint8_t kWdlMagic[4] = {0x71, 0xe8, 0x23, 0x5d};
+constexpr uint8_t kDtzMagic[4] = {0xd7, 0x66, 0x0c, 0xa5};
+
+// Flags of each table in a file
+constexpr int kFlagStm = 1;
+constexpr int kFlagMapped = 2;
+constexpr int kFlagWinPlies = 4;
+constexpr int kFlagLossPlies = 8;
+constexpr int kFlagWide = 16;
+constexpr int kFlagSingleValue = 128;
+
+// Files number pieces 1-6 for pawn, knight, bishop, rook, queen and king, plus
+// 8 for Black. This maps EPieceType to that order.
+constexpr int kSyzygyType[kPieceTypeCount] = {1, 4, 3, 5, 6, 2};
+constexpr const char *kSyzygyChars = " PNBRQK";
+
+// Index tables shared by every file, see initIndexTables()
+int sMapPawns[kSquareCount];
+int sMapB1H1H7[kSquareCount];
+int sMapA1D1D4[kSquareCount];
+int sMapKK[10][kSquareCount];
+int sBinomial[6][kSquareCount];
+int sLeadPawnIdx[6][kSquareCount];
+int sLeadPawnsSize[6][4];
+
+uint16_t readLe16(const uint8_t *pData) { return pData[0] | pData[1] << 8; }
+
+uint32_t readLe32(const uint8_t *pData) {
+    return pData[0] | pData[1] << 8 | pData[2] << 16 | static_cast<uint32_t>(pData[3]) << 24;
+}
+
+uint32_t readBe32(const uint8_t *pData) {
+    return static_cast<uint32_t>(pData[0]) << 24 | pData[1] << 16 | pData[2] << 8 | pData[3];
+}
+
+uint64_t readBe64(const uint8_t *pData) {
+    return static_cast<uint64_t>(readBe32(pData)) << 32 | readBe32(pData + 4);
+}
+
+// Which side of the a1-h8 diagonal the square is: negative below, 0 on it
+int offA1H8(int pSquare) { return rankOf(pSquare) - fileOf(pSquare); }
+
+int syzygyPiece(PieceCode pPiece) {
+    return kSyzygyType[static_cast<int>(pieceType(pPiece))] +
+           (pieceColor(pPiece) == EPieceColor::BLACK ? 8 : 0);
+}
+
+// The leading pawn is the one with the highest sMapPawns[], nearest the edge
+bool pawnsBefore(int pSquare, int pOther) { return sMapPawns[pSquare] < sMapPawns[pOther]; }
+
+int signOf(int pValue) { return (pValue > 0) - (pValue < 0); }
+
+void initIndexTables() {
+    AttackTables::init();
+    static const bool sInitialized = [] {
+        int code = 0;
+        for (int square = 0; square < kSquareCount; square++) {
+            if (offA1H8(square) < 0) {
+                sMapB1H1H7[square] = code++;
+            }
+        }
+
+        // a1-d1-d4 triangle, the squares on the diagonal last
+        std::vector<int> diagonal;
+        code = 0;
+        for (int square = 0; square <= makeSquare(3, 3); square++) {
+            if (offA1H8(square) < 0 && fileOf(square) <= 3) {
+                sMapA1D1D4[square] = code++;
+            } else if (!offA1H8(square) && fileOf(square) <= 3) {
+                diagonal.push_back(square);
+            }
+        }
+        for (int square : diagonal) {
+            sMapA1D1D4[square] = code++;
+        }
+
+        // The 462 placements of two kings with the first in the triangle; when
+        // it is on the diagonal the second isn't above it. Both on the
+        // diagonal come last.
+        std::vector<std::pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; idx++) {
+            for (int first = 0; first <= makeSquare(3, 3); first++) {
+                if (sMapA1D1D4[first] != idx || (!idx && first != makeSquare(1, 0))) {
+                    continue;
+                }
+                for (int second = 0; second < kSquareCount; second++) {
+                    if ((AttackTables::kingAttacks(first) | squareBit(first)) & squareBit(second)) {
+                        continue;
+                    } else if (!offA1H8(first) && offA1H8(second) > 0) {
+                        continue;
+                    } else if (!offA1H8(first) && !offA1H8(second)) {
+                        bothOnDiagonal.emplace_back(idx, second);
+                    } else {
+                        sMapKK[idx][second] = code++;
+                    }
+                }
+            }
+        }
+        for (auto &kings : bothOnDiagonal) {
+            sMapKK[kings.first][kings.second] = code++;
+        }
+
+        // Ways to choose k of n squares
+        sBinomial[0][0] = 1;
+        for (int n = 1; n < kSquareCount; n++) {
+            for (int k = 0; k < 6 && k <= n; k++) {
+                sBinomial[k][n] = (k > 0 ? sBinomial[k - 1][n - 1] : 0) +
+                                  (k < n ? sBinomial[k][n - 1] : 0);
+            }
+        }
+
+        // sMapPawns[] numbers a2-h7 from the edges inwards and, per file, from
+        // the second rank up: the squares left to the other pawns when the
+        // leading one is there. Pawn tables are split by the leading pawn's file.
+        int availableSquares = 47;
+        for (int leadPawns = 1; leadPawns <= 5; leadPawns++) {
+            for (int file = 0; file < 4; file++) {
+                int idx = 0;
+                for (int rank = 1; rank <= 6; rank++) {
+                    const int square = makeSquare(file, rank);
+                    if (leadPawns == 1) {
+                        sMapPawns[square] = availableSquares--;
+                        sMapPawns[square ^ 7] = availableSquares--;
+                    }
+                    sLeadPawnIdx[leadPawns][square] = idx;
+                    idx += sBinomial[leadPawns - 1][sMapPawns[square]];
+                }
+                sLeadPawnsSize[leadPawns][file] = idx;
+            }
+        }
+        return true;
+    }();
+    (void)sInitialized;
+}
+
+// One table of a file: values compressed by recursive pairing, where every
+// symbol stands for a pair of shorter ones down to the stored values, then
+// coded by canonical Huffman in blocks
+struct PairsData {
+    int mFlags = 0;
+    // Shortest code length, or the value itself for single-value tables
+    int mMinSymLen = 0;
+    uint64_t mBlockSize = 0;
+    // Every mSpan values there is a sparse index entry
+    uint64_t mSpan = 0;
+    uint32_t mNumBlocks = 0;
+    uint32_t mBlockLengthSize = 0;
+    uint64_t mSparseIndexSize = 0;
+    // Lowest symbol of each code length
+    const uint8_t *mLowestSym = nullptr;
+    // Pairs expanding each symbol, 12 bits per side
+    const uint8_t *mSymbols = nullptr;
+    // Values minus one stored in each block
+    const uint8_t *mBlockLength = nullptr;
+    // Block and offset of the value in the middle of each span
+    const uint8_t *mSparseIndex = nullptr;
+    const uint8_t *mData = nullptr;
+    // Lowest code of each length, left-aligned in 64 bits
+    std::vector<uint64_t> mBase64;
+    // Values minus one each symbol expands into
+    std::vector<uint8_t> mSymLen;
+    // Order of the pieces, which groups them for the index
+    int mPieces[kMaxTablePieces] = {};
+    uint64_t mGroupIdx[kMaxTablePieces + 1] = {};
+    int mGroupLen[kMaxTablePieces + 1] = {};
+    // DTZ only: where the values of wins, losses, cursed wins and blessed
+    // losses start in the map
+    int mMapIdx[4] = {};
+
+    int leftSymbol(int pSymbol) const {
+        const uint8_t *pair = mSymbols + 3 * pSymbol;
+        return (pair[1] & 0xf) << 8 | pair[0];
+    }
+    int rightSymbol(int pSymbol) const {
+        const uint8_t *pair = mSymbols + 3 * pSymbol;
+        return pair[2] << 4 | pair[1] >> 4;
+    }
+    int blockLength(uint32_t pBlock) const { return readLe16(mBlockLength + 2 * pBlock); }
+};
+
+struct Table {
+    MappedFile mFile;
+    bool mDtz = false;
+    // [side to move][file of the leading pawn]; DTZ files store one side
+    PairsData mItems[2][4];
+    // DTZ only: values the stored ones are mapped to
+    const uint8_t *mMap = nullptr;
+
+    PairsData &get(int pStm, int pFile, bool pHasPawns) {
+        return mItems[mDtz ? 0 : pStm][pHasPawns ? pFile : 0];
+    }
+    const PairsData &get(int pStm, int pFile, bool pHasPawns) const {
+        return mItems[mDtz ? 0 : pStm][pHasPawns ? pFile : 0];
+    }
+};
+
+// Material signature, one nibble per piece count: the first side in the
+// table name, or White for a position, in the low half
+using MaterialKey = uint64_t;
+
+struct TableEntry {
+    MaterialKey mKey = 0;
+    // The same material with the colors swapped
+    MaterialKey mKey2 = 0;
+    int mPieceCount = 0;
+    bool mHasPawns = false;
+    bool mHasUniquePieces = false;
+    // Pawns of the leading color, then of the other
+    int mPawnCount[2] = {};
+    Table mWdl;
+    Table mDtz;
+    bool mHasDtz = false;
+};
+
+std::vector<std::unique_ptr<TableEntry>> sEntries;
+std::unordered_map<MaterialKey, const TableEntry *> sEntriesByKey;
+int sMaxPieces = 0;
+
+MaterialKey materialKey(const Position &pPosition) {
+    MaterialKey key = 0;
+    for (EPieceColor color : {EPieceColor::WHITE, EPieceColor::BLACK}) {
+        const int side = color == EPieceColor::WHITE ? 0 : 8;
+        for (int type = 0; type < kPieceTypeCount; type++) {
+            const int count = popCount(pPosition.pieces(color, static_cast<EPieceType>(type)));
+            key += static_cast<MaterialKey>(count) << (4 * (side + kSyzygyType[type]));
+        }
+    }
+    return key;
+}
+
+// Reads the material of a file name like KRPvKR
+bool parseMaterial(const std::string &pName, TableEntry &pEntry) {
+    int counts[2][8] = {};
+    int side = 0;
+    for (char c : pName) {
+        const char *type = c == ' ' ? nullptr : std::strchr(kSyzygyChars, c);
+        if (c == 'v' && side == 0) {
+            side = 1;
+        } else if (type && c) {
+            counts[side][type - kSyzygyChars]++;
+        } else {
+            return false;
+        }
+    }
+    if (side != 1 || counts[0][6] != 1 || counts[1][6] != 1) {
+        return false;
+    }
+    pEntry.mPieceCount = 0;
+    for (int type = 1; type <= 6; type++) {
+        pEntry.mKey += static_cast<MaterialKey>(counts[0][type]) << (4 * type);
+        pEntry.mKey += static_cast<MaterialKey>(counts[1][type]) << (4 * (8 + type));
+        pEntry.mKey2 += static_cast<MaterialKey>(counts[1][type]) << (4 * type);
+        pEntry.mKey2 += static_cast<MaterialKey>(counts[0][type]) << (4 * (8 + type));
+        pEntry.mPieceCount += counts[0][type] + counts[1][type];
+        pEntry.mHasUniquePieces |= type < 6 && (counts[0][type] == 1 || counts[1][type] == 1);
+    }
+    if (pEntry.mPieceCount > kMaxTablePieces) {
+        return false;
+    }
+    pEntry.mHasPawns = counts[0][1] || counts[1][1];
+    // With pawns on both sides the side with fewer leads, as it compresses better
+    const bool firstLeads = !counts[1][1] || (counts[0][1] && counts[1][1] >= counts[0][1]);
+    pEntry.mPawnCount[0] = counts[firstLeads ? 0 : 1][1];
+    pEntry.mPawnCount[1] = counts[firstLeads ? 1 : 0][1];
+    return true;
+}
+
+// The pieces of a table fall into groups of equal pieces, with the leading
+// group first; the file says in which order the groups are numbered
+void setGroups(const TableEntry &pEntry, PairsData &pData, const int pOrder[2], int pFile) {
+    int n = 0;
+    int firstLen = pEntry.mHasPawns ? 0 : pEntry.mHasUniquePieces ? 3 : 2;
+    pData.mGroupLen[n] = 1;
+    for (int i = 1; i < pEntry.mPieceCount; i++) {
+        if (--firstLen > 0 || pData.mPieces[i] == pData.mPieces[i - 1]) {
+            pData.mGroupLen[n]++;
+        } else {
+            pData.mGroupLen[++n] = 1;
+        }
+    }
+    pData.mGroupLen[++n] = 0;
+
+    const bool bothHavePawns = pEntry.mHasPawns && pEntry.mPawnCount[1];
+    int next = bothHavePawns ? 2 : 1;
+    int freeSquares = 64 - pData.mGroupLen[0] - (bothHavePawns ? pData.mGroupLen[1] : 0);
+    uint64_t idx = 1;
+    for (int k = 0; next < n || k == pOrder[0] || k == pOrder[1]; k++) {
+        if (k == pOrder[0]) {
+            // Leading pawns or pieces
+            pData.mGroupIdx[0] = idx;
+            idx *= pEntry.mHasPawns          ? sLeadPawnsSize[pData.mGroupLen[0]][pFile]
+                   : pEntry.mHasUniquePieces ? 31332
+                                             : 462;
+        } else if (k == pOrder[1]) {
+            // The other side's pawns
+            pData.mGroupIdx[1] = idx;
+            idx *= sBinomial[pData.mGroupLen[1]][48 - pData.mGroupLen[0]];
+        } else {
+            pData.mGroupIdx[next] = idx;
+            idx *= sBinomial[pData.mGroupLen[next]][freeSquares];
+            freeSquares -= pData.mGroupLen[next++];
+        }
+    }
+    pData.mGroupIdx[n] = idx;
+}
+
+uint8_t setSymLen(PairsData &pData, int pSymbol, std::vector<bool> &pVisited) {
+    // The pairs form a tree, so a symbol can be marked before its children
+    pVisited[pSymbol] = true;
+    const int right = pData.rightSymbol(pSymbol);
+    if (right == 0xfff) {
+        return 0;
+    }
+    const int left = pData.leftSymbol(pSymbol);
+    if (!pVisited[left]) {
+        pData.mSymLen[left] = setSymLen(pData, left, pVisited);
+    }
+    if (!pVisited[right]) {
+        pData.mSymLen[right] = setSymLen(pData, right, pVisited);
+    }
+    return pData.mSymLen[left] + pData.mSymLen[right] + 1;
+}
+
+const uint8_t *setSizes(PairsData &pData, const uint8_t *pBytes) {
+    pData.mFlags = *pBytes++;
+    if (pData.mFlags & kFlagSingleValue) {
+        pData.mMinSymLen = *pBytes++;
+        return pBytes;
+    }
+
+    // The last group index is the size of the table
+    const uint64_t tableSize =
+        pData.mGroupIdx[std::find(pData.mGroupLen, pData.mGroupLen + kMaxTablePieces, 0) -
+                        pData.mGroupLen];
+    pData.mBlockSize = 1ULL << *pBytes++;
+    pData.mSpan = 1ULL << *pBytes++;
+    pData.mSparseIndexSize = (tableSize + pData.mSpan - 1) / pData.mSpan;
+    const int padding = *pBytes++;
+    pData.mNumBlocks = readLe32(pBytes);
+    pBytes += 4;
+    // Padded so the sparse index can't point past the end
+    pData.mBlockLengthSize = pData.mNumBlocks + padding;
+    const int maxSymLen = *pBytes++;
+    pData.mMinSymLen = *pBytes++;
+    pData.mLowestSym = pBytes;
+    pData.mBase64.assign(maxSymLen - pData.mMinSymLen + 1, 0);
+
+    // Longer codes have lower values in a canonical code, so the lowest code
+    // of each length follows from the next longer one
+    for (int i = static_cast<int>(pData.mBase64.size()) - 2; i >= 0; i--) {
+        pData.mBase64[i] = (pData.mBase64[i + 1] + readLe16(pData.mLowestSym + 2 * i) -
+                            readLe16(pData.mLowestSym + 2 * (i + 1))) /
+                           2;
+    }
+    for (size_t i = 0; i < pData.mBase64.size(); i++) {
+        pData.mBase64[i] <<= 64 - i - pData.mMinSymLen;
+    }
+
+    pBytes += pData.mBase64.size() * 2;
+    pData.mSymLen.assign(readLe16(pBytes), 0);
+    pBytes += 2;
+    pData.mSymbols = pBytes;
+    std::vector<bool> visited(pData.mSymLen.size());
+    for (size_t symbol = 0; symbol < pData.mSymLen.size(); symbol++) {
+        if (!visited[symbol]) {
+            pData.mSymLen[symbol] = setSymLen(pData, static_cast<int>(symbol), visited);
+        }
+    }
+    return pBytes + pData.mSymLen.size() * 3 + (pData.mSymLen.size() & 1);
+}
+
+const uint8_t *setDtzMap(const TableEntry &pEntry, Table &pTable, const uint8_t *pBase,
+                         const uint8_t *pBytes, int pMaxFile) {
+    pTable.mMap = pBytes;
+    for (int file = 0; file <= pMaxFile; file++) {
+        PairsData &data = pTable.get(0, file, pEntry.mHasPawns);
+        if (!(data.mFlags & kFlagMapped)) {
+            continue;
+        }
+        // Each of the four maps starts with its length; indices skip it
+        if (data.mFlags & kFlagWide) {
+            pBytes += (pBytes - pBase) & 1;
+            for (int i = 0; i < 4; i++) {
+                data.mMapIdx[i] = static_cast<int>((pBytes - pTable.mMap) / 2 + 1);
+                pBytes += 2 * readLe16(pBytes) + 2;
+            }
+        } else {
+            for (int i = 0; i < 4; i++) {
+                data.mMapIdx[i] = static_cast<int>(pBytes - pTable.mMap + 1);
+                pBytes += *pBytes + 1;
+            }
+        }
+    }
+    return pBytes + ((pBytes - pBase) & 1);
+}
+
+// Reads the layout of a mapped file; false if it doesn't match its name
+bool setupTable(const TableEntry &pEntry, Table &pTable) {
+    const uint8_t *base = pTable.mFile.data();
+    const uint8_t *bytes = base + 4;
+    const bool split = pEntry.mKey != pEntry.mKey2;
+    if (static_cast<bool>(*bytes & 2) != pEntry.mHasPawns ||
+        (!pTable.mDtz && static_cast<bool>(*bytes & 1) != split)) {
+        return false;
+    }
+    bytes++;
+
+    const int sides = !pTable.mDtz && split ? 2 : 1;
+    const int maxFile = pEntry.mHasPawns ? 3 : 0;
+    const bool bothHavePawns = pEntry.mHasPawns && pEntry.mPawnCount[1];
+    for (int file = 0; file <= maxFile; file++) {
+        for (int side = 0; side < sides; side++) {
+            pTable.get(side, file, pEntry.mHasPawns) = PairsData();
+        }
+        const int order[2][2] = {{bytes[0] & 0xf, bothHavePawns ? bytes[1] & 0xf : 0xf},
+                                 {bytes[0] >> 4, bothHavePawns ? bytes[1] >> 4 : 0xf}};
+        bytes += 1 + bothHavePawns;
+        for (int k = 0; k < pEntry.mPieceCount; k++, bytes++) {
+            for (int side = 0; side < sides; side++) {
+                pTable.get(side, file, pEntry.mHasPawns).mPieces[k] =
+                    side ? *bytes >> 4 : *bytes & 0xf;
+            }
+        }
+        for (int side = 0; side < sides; side++) {
+            setGroups(pEntry, pTable.get(side, file, pEntry.mHasPawns), order[side], file);
+        }
+    }
+    bytes += (bytes - base) & 1;
+
+    for (int file = 0; file <= maxFile; file++) {
+        for (int side = 0; side < sides; side++) {
+            bytes = setSizes(pTable.get(side, file, pEntry.mHasPawns), bytes);
+        }
+    }
+    if (pTable.mDtz) {
+        bytes = setDtzMap(pEntry, pTable, base, bytes, maxFile);
+    }
+    for (int file = 0; file <= maxFile; file++) {
+        for (int side = 0; side < sides; side++) {
+            PairsData &data = pTable.get(side, file, pEntry.mHasPawns);
+            data.mSparseIndex = bytes;
+            bytes += data.mSparseIndexSize * 6;
+        }
+    }
+    for (int file = 0; file <= maxFile; file++) {
+        for (int side = 0; side < sides; side++) {
+            PairsData &data = pTable.get(side, file, pEntry.mHasPawns);
+            data.mBlockLength = bytes;
+            bytes += data.mBlockLengthSize * 2;
+        }
+    }
+    for (int file = 0; file <= maxFile; file++) {
+        for (int side = 0; side < sides; side++) {
+            // Compressed blocks are 64-byte aligned
+            bytes = base + ((bytes - base + 63) & ~static_cast<ptrdiff_t>(63));
+            PairsData &data = pTable.get(side, file, pEntry.mHasPawns);
+            data.mData = bytes;
+            bytes += data.mNumBlocks * data.mBlockSize;
+        }
+    }
+    return bytes <= base + pTable.mFile.size();
+}
+
+bool mapTable(const TableEntry &pEntry, Table &pTable, const std::string &pPath, bool pDtz) {
+    pTable.mDtz = pDtz;
+    // Files are a 16-byte header short of a multiple of 64 bytes
+    if (!pTable.mFile.open(pPath) || pTable.mFile.size() < 64 || pTable.mFile.size() % 64 != 16 ||
+        std::memcmp(pTable.mFile.data(), pDtz ? kDtzMagic : kWdlMagic, 4) != 0 ||
+        !setupTable(pEntry, pTable)) {
+        pTable.mFile.close();
+        return false;
+    }
+    return true;
+}
+
+int decompressPairs(const PairsData &pData, uint64_t pIndex) {
+    if (pData.mFlags & kFlagSingleValue) {
+        return pData.mMinSymLen;
+    }
+
+    // The sparse index locates the value in the middle of pIndex's span; from
+    // there walk the block lengths to the block holding pIndex
+    const uint8_t *sparse = pData.mSparseIndex + 6 * (pIndex / pData.mSpan);
+    uint32_t block = readLe32(sparse);
+    int offset = readLe16(sparse + 4) + static_cast<int>(pIndex % pData.mSpan) -
+                 static_cast<int>(pData.mSpan / 2);
+    while (offset < 0) {
+        offset += pData.blockLength(--block) + 1;
+    }
+    while (offset > pData.blockLength(block)) {
+        offset -= pData.blockLength(block++) + 1;
+    }
+
+    // Decode symbols from the start of the block until one covers the offset
+    const uint8_t *bytes = pData.mData + block * pData.mBlockSize;
+    uint64_t buffer = readBe64(bytes);
+    bytes += 8;
+    int bufferBits = 64;
+    int symbol;
+    while (true) {
+        // Lengths past the shortest
+        int len = 0;
+        while (buffer < pData.mBase64[len]) {
+            len++;
+        }
+        symbol = static_cast<int>((buffer - pData.mBase64[len]) >> (64 - len - pData.mMinSymLen));
+        symbol += readLe16(pData.mLowestSym + 2 * len);
+        if (offset < pData.mSymLen[symbol] + 1) {
+            break;
+        }
+        offset -= pData.mSymLen[symbol] + 1;
+        len += pData.mMinSymLen;
+        buffer <<= len;
+        bufferBits -= len;
+        if (bufferBits <= 32) {
+            bufferBits += 32;
+            buffer |= static_cast<uint64_t>(readBe32(bytes)) << (64 - bufferBits);
+            bytes += 4;
+        }
+    }
+
+    // Expand the pairs down to the value at the offset
+    while (pData.mSymLen[symbol]) {
+        const int left = pData.leftSymbol(symbol);
+        if (offset < pData.mSymLen[left] + 1) {
+            symbol = left;
+        } else {
+            offset -= pData.mSymLen[left] + 1;
+            symbol = pData.rightSymbol(symbol);
+        }
+    }
+    return pData.leftSymbol(symbol);
+}
+
+// Converts a stored DTZ value to plies for a position with the given result
+int mapDtz(const TableEntry &pEntry, const Table &pTable, int pFile, int pValue, int pWdl) {
+    constexpr int kWdlMap[] = {1, 3, 0, 2, 0};
+    const PairsData &data = pTable.get(0, pFile, pEntry.mHasPawns);
+    if (data.mFlags & kFlagMapped) {
+        const int index = data.mMapIdx[kWdlMap[pWdl + 2]] + pValue;
+        pValue = data.mFlags & kFlagWide ? readLe16(pTable.mMap + 2 * index) : pTable.mMap[index];
+    }
+    // Tables store moves unless their flags say plies
+    if ((pWdl == Tablebases::kWin && !(data.mFlags & kFlagWinPlies)) ||
+        (pWdl == Tablebases::kLoss && !(data.mFlags & kFlagLossPlies)) ||
+        pWdl == Tablebases::kCursedWin || pWdl == Tablebases::kBlessedLoss) {
+        pValue *= 2;
+    }
+    return pValue + 1;
+}
+
+// Where the table stores the position: side to move, file of the leading
+// pawn and index. False when a DTZ table only has the other side to move.
+bool tableIndex(const Position &pPosition, const TableEntry &pEntry, const Table &pTable,
+                int &pStm, int &pFile, uint64_t &pIndex) {
+    int squares[kMaxTablePieces];
+    int pieces[kMaxTablePieces];
+    int size = 0;
+    int leadPawnsCount = 0;
+    int tableFile = 0;
+    Bitboard leadPawns = 0;
+
+    // Tables are stored with the first side in their name as White, and
+    // symmetric ones only with White to move; other positions are probed
+    // with the colors swapped and the board mirrored
+    const bool blackToMove = pPosition.sideToMove() == EPieceColor::BLACK;
+    const bool flip = (pEntry.mKey == pEntry.mKey2 && blackToMove) ||
+                      materialKey(pPosition) != pEntry.mKey;
+    const int flipColor = flip ? 8 : 0;
+    const int flipSquares = flip ? 56 : 0;
+    const int stm = flip != blackToMove;
+
+    // Pawn tables are split by the file of the leading pawn, after mirroring
+    // it onto files a-d
+    if (pEntry.mHasPawns) {
+        const int pawn = pTable.get(0, 0, true).mPieces[0] ^ flipColor;
+        leadPawns = pPosition.pieces(pawn & 8 ? EPieceColor::BLACK : EPieceColor::WHITE,
+                                     EPieceType::PAWN);
+        for (Bitboard board = leadPawns; board;) {
+            squares[size++] = popLsb(board) ^ flipSquares;
+        }
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, pawnsBefore));
+        tableFile = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    if (pTable.mDtz) {
+        const int flags = pTable.get(0, tableFile, pEntry.mHasPawns).mFlags;
+        if ((flags & kFlagStm) != stm && (pEntry.mKey != pEntry.mKey2 || pEntry.mHasPawns)) {
+            return false;
+        }
+    }
+
+    for (Bitboard board = pPosition.occupied() & ~leadPawns; board;) {
+        const int square = popLsb(board);
+        squares[size] = square ^ flipSquares;
+        pieces[size++] = syzygyPiece(pPosition.pieceAt(square)) ^ flipColor;
+    }
+
+    const PairsData &data = pTable.get(stm, tableFile, pEntry.mHasPawns);
+
+    // Put the pieces in the table's order
+    for (int i = leadPawnsCount; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            if (data.mPieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // The leading piece goes to files a-d
+    if (fileOf(squares[0]) > 3) {
+        for (int i = 0; i < size; i++) {
+            squares[i] ^= 7;
+        }
+    }
+
+    uint64_t idx;
+    if (pEntry.mHasPawns) {
+        idx = sLeadPawnIdx[leadPawnsCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsBefore);
+        for (int i = 1; i < leadPawnsCount; i++) {
+            idx += sBinomial[i][sMapPawns[squares[i]]];
+        }
+    } else {
+        // Without pawns the leading piece also goes to ranks 1-4, and the
+        // first piece of the leading group off the a1-h8 diagonal below it
+        if (rankOf(squares[0]) > 3) {
+            for (int i = 0; i < size; i++) {
+                squares[i] ^= 56;
+            }
+        }
+        for (int i = 0; i < data.mGroupLen[0]; i++) {
+            if (!offA1H8(squares[i])) {
+                continue;
+            }
+            if (offA1H8(squares[i]) > 0) {
+                for (int j = i; j < size; j++) {
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if (pEntry.mHasUniquePieces) {
+            // The kings and a unique piece are numbered together, skipping the
+            // squares taken by those before them
+            const int adjust1 = squares[1] > squares[0];
+            const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offA1H8(squares[0])) {
+                idx = (sMapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] -
+                      adjust2;
+            } else if (offA1H8(squares[1])) {
+                idx = (6 * 63 + rankOf(squares[0]) * 28 + sMapB1H1H7[squares[1]]) * 62 +
+                      squares[2] - adjust2;
+            } else if (offA1H8(squares[2])) {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28 +
+                      (rankOf(squares[1]) - adjust1) * 28 + sMapB1H1H7[squares[2]];
+            } else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6 +
+                      (rankOf(squares[1]) - adjust1) * 6 + (rankOf(squares[2]) - adjust2);
+            }
+        } else {
+            idx = sMapKK[sMapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // Every further group is numbered by its squares in ascending order,
+    // skipping those of the groups before it; the other side's pawns only
+    // count ranks 2-7
+    idx *= data.mGroupIdx[0];
+    int *groupSquares = squares + data.mGroupLen[0];
+    bool remainingPawns = pEntry.mHasPawns && pEntry.mPawnCount[1];
+    for (int next = 1; data.mGroupLen[next]; next++) {
+        std::stable_sort(groupSquares, groupSquares + data.mGroupLen[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < data.mGroupLen[next]; i++) {
+            const int adjust = static_cast<int>(std::count_if(
+                squares, groupSquares, [&](int pSquare) { return groupSquares[i] > pSquare; }));
+            n += sBinomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * data.mGroupIdx[next];
+        groupSquares += data.mGroupLen[next];
+    }
+
+    pStm = stm;
+    pFile = tableFile;
+    pIndex = idx;
+    return true;
+}
+
+// The value the table stores for the position: the result for win/draw/loss
+// tables, the distance to zeroing for DTZ ones, which need the result. False
+// when a DTZ table only has the other side to move.
+bool probeTable(const Position &pPosition, const TableEntry &pEntry, const Table &pTable, int pWdl,
+                int &pValue) {
+    int stm, file;
+    uint64_t idx;
+    if (!tableIndex(pPosition, pEntry, pTable, stm, file, idx)) {
+        return false;
+    }
+    const int value = decompressPairs(pTable.get(stm, file, pEntry.mHasPawns), idx);
+    pValue = pTable.mDtz ? mapDtz(pEntry, pTable, file, value, pWdl) : value - 2;
+    return true;
+}
+
+enum class EProbeState {
+    FAIL,
+    OK,
+    // The DTZ table stores the other side to move
+    CHANGE_STM,
+    // The best move captures or moves a pawn, so the DTZ table can't be used
+    ZEROING_BEST_MOVE
+};
+
+const TableEntry *findEntry(const Position &pPosition) {
+    auto found = sEntriesByKey.find(materialKey(pPosition));
+    return found == sEntriesByKey.end() ? nullptr : found->second;
+}
+
+int probeWdlTable(const Position &pPosition, EProbeState &pState) {
+    if (popCount(pPosition.occupied()) == 2) {
+        return Tablebases::kDraw;
+    }
+    const TableEntry *entry = findEntry(pPosition);
+    int wdl;
+    if (!entry || !probeTable(pPosition, *entry, entry->mWdl, Tablebases::kDraw, wdl)) {
+        pState = EProbeState::FAIL;
+        return Tablebases::kDraw;
+    }
+    return wdl;
+}
+
+bool hasLegalMoves(const Position &pPosition) {
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+    return !moves.empty();
+}
+
+bool isZeroing(const Position &pPosition, const PositionMove &pMove) {
+    return pMove.isCapture() || pieceType(pPosition.pieceAt(pMove.from())) == EPieceType::PAWN;
+}
+
+// Tables may store anything for positions with a winning capture, and a loss
+// for positions drawn by a capture, and nothing about en passant; so the
+// captures are searched and the best of them and the table is the result.
+// DTZ tables likewise skip positions with a winning pawn move, which
+// pCheckPawnMoves searches too.
+int searchWdl(Position &pPosition, bool pCheckPawnMoves, EProbeState &pState) {
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+    int bestWdl = Tablebases::kLoss;
+    size_t searched = 0;
+    for (auto &move : moves) {
+        if (!move.isCapture() &&
+            (!pCheckPawnMoves ||
+             pieceType(pPosition.pieceAt(move.from())) != EPieceType::PAWN)) {
+            continue;
+        }
+        searched++;
+        pPosition.makeMove(move);
+        const int wdl = -searchWdl(pPosition, false, pState);
+        pPosition.undoMove();
+        if (pState == EProbeState::FAIL) {
+            return Tablebases::kDraw;
+        }
+        if (wdl > bestWdl) {
+            bestWdl = wdl;
+            if (wdl >= Tablebases::kWin) {
+                pState = EProbeState::ZEROING_BEST_MOVE;
+                return wdl;
+            }
+        }
+    }
+
+    // With every move searched the table isn't needed, and may be wrong
+    const bool allSearched = searched && searched == moves.size();
+    int wdl = bestWdl;
+    if (!allSearched) {
+        wdl = probeWdlTable(pPosition, pState);
+        if (pState == EProbeState::FAIL) {
+            return Tablebases::kDraw;
+        }
+    }
+    if (bestWdl >= wdl) {
+        pState = bestWdl > Tablebases::kDraw || allSearched ? EProbeState::ZEROING_BEST_MOVE
+                                                            : EProbeState::OK;
+        return bestWdl;
+    }
+    pState = EProbeState::OK;
+    return wdl;
+}
+
+// DTZ of a position whose best move zeroes the fifty-move counter
+int dtzBeforeZeroing(int pWdl) {
+    switch (pWdl) {
+        case Tablebases::kWin: return 1;
+        case Tablebases::kCursedWin: return 101;
+        case Tablebases::kBlessedLoss: return -101;
+        case Tablebases::kLoss: return -1;
+        default: return 0;
+    }
+}
+
+int probeDtzPosition(Position &pPosition, EProbeState &pState) {
+    pState = EProbeState::OK;
+    const int wdl = searchWdl(pPosition, true, pState);
+    // Draws aren't stored
+    if (pState == EProbeState::FAIL || wdl == Tablebases::kDraw) {
+        return 0;
+    }
+    if (pState == EProbeState::ZEROING_BEST_MOVE) {
+        return dtzBeforeZeroing(wdl);
+    }
+
+    const TableEntry *entry = findEntry(pPosition);
+    if (!entry || !entry->mHasDtz) {
+        pState = EProbeState::FAIL;
+        return 0;
+    }
+    int dtz;
+    if (probeTable(pPosition, *entry, entry->mDtz, wdl, dtz)) {
+        const bool cursed = wdl == Tablebases::kCursedWin || wdl == Tablebases::kBlessedLoss;
+        return (dtz + 100 * cursed) * signOf(wdl);
+    }
+
+    // The table stores the other side to move: take the best DTZ a ply on
+    int minDtz = 0xffff;
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+    for (auto &move : moves) {
+        const bool zeroing = isZeroing(pPosition, move);
+        pPosition.makeMove(move);
+        // A zeroing move counts from before it, so only its result matters
+        dtz = zeroing ? -dtzBeforeZeroing(searchWdl(pPosition, false, pState))
+                      : -probeDtzPosition(pPosition, pState);
+        if (dtz == 1 && pPosition.checkers() && !hasLegalMoves(pPosition)) {
+            minDtz = 1;
+        }
+        if (!zeroing) {
+            dtz += signOf(dtz);
+        }
+        // Only moves keeping the result count
+        if (dtz < minDtz && signOf(dtz) == signOf(wdl)) {
+            minDtz = dtz;
+        }
+        pPosition.undoMove();
+        if (pState == EProbeState::FAIL) {
+            return 0;
+        }
+    }
+    // Without moves the position is mate
+    return minDtz == 0xffff ? -1 : minDtz;
+}
+
+// Tables don't know castling; a position with both kings and no more pieces
+// than the largest table may be covered
+bool mayBeCovered(const Position &pPosition) {
+    return popCount(pPosition.occupied()) <= sMaxPieces && !pPosition.castlingRights() &&
+           popCount(pPosition.pieces(EPieceColor::WHITE, EPieceType::KING)) == 1 &&
+           popCount(pPosition.pieces(EPieceColor::BLACK, EPieceType::KING)) == 1;
+}
+
+void addTable(const std::filesystem::path &pPath) {
+    auto entry = std::make_unique<TableEntry>();
+    if (!parseMaterial(pPath.stem().string(), *entry) || sEntriesByKey.count(entry->mKey) ||
+        !mapTable(*entry, entry->mWdl, pPath.string(), false)) {
+        return;
+    }
+    std::filesystem::path dtzPath = pPath;
+    dtzPath.replace_extension(".rtbz");
+    entry->mHasDtz = mapTable(*entry, entry->mDtz, dtzPath.string(), true);
+    sMaxPieces = std::max(sMaxPieces, entry->mPieceCount);
+    sEntriesByKey[entry->mKey] = entry.get();
+    sEntriesByKey[entry->mKey2] = entry.get();
+    sEntries.push_back(std::move(entry));
+}
+
+}  // namespace
+
+int Tablebases::init(const std::string &pPaths) {
+    initIndexTables();
+    sEntriesByKey.clear();
+    sEntries.clear();
+    sMaxPieces = 0;
+    for (size_t start = 0; start <= pPaths.size();) {
+        size_t end = std::min(pPaths.find(kPathSeparator, start), pPaths.size());
+        const std::string directory = pPaths.substr(start, end - start);
+        start = end + 1;
+        if (directory.empty()) {
+            continue;
+        }
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(directory, error), last; !error && it != last;
+             it.increment(error)) {
+            if (it->path().extension() == ".rtbw") {
+                addTable(it->path());
+            }
+        }
+    }
+    return count();
+}
+
+int Tablebases::count() { return static_cast<int>(sEntries.size()); }
+
+int Tablebases::maxPieces() { return sMaxPieces; }
+
+bool Tablebases::probeWdl(Position &pPosition, int &pWdl) {
+    if (!mayBeCovered(pPosition)) {
+        return false;
+    }
+    EProbeState state = EProbeState::OK;
+    pWdl = searchWdl(pPosition, false, state);
+    return state != EProbeState::FAIL;
+}
+
+bool Tablebases::probeDtz(Position &pPosition, int &pDtz) {
+    if (!mayBeCovered(pPosition)) {
+        return false;
+    }
+    EProbeState state;
+    pDtz = probeDtzPosition(pPosition, state);
+    return state != EProbeState::FAIL;
+}
+
+bool Tablebases::probeRoot(Position &pPosition, std::vector<PositionMove> &pBestMoves,
+                           int &pScore) {
+    if (!mayBeCovered(pPosition)) {
+        return false;
+    }
+    MoveList moves;
+    generateLegalMoves(pPosition, moves);
+    const int halfmoves = pPosition.halfmoveClock();
+    int bestRank = -kMaxDtz - 1;
+    pBestMoves.clear();
+    for (auto &move : moves) {
+        pPosition.makeMove(move);
+        EProbeState state = EProbeState::OK;
+        int dtz;
+        if (pPosition.halfmoveClock() == 0) {
+            dtz = dtzBeforeZeroing(-searchWdl(pPosition, false, state));
+        } else if (pPosition.halfmoveClock() >= 100 &&
+                   !(pPosition.checkers() && !hasLegalMoves(pPosition))) {
+            // Drawn by the fifty-move rule
+            dtz = 0;
+        } else {
+            dtz = -probeDtzPosition(pPosition, state);
+            dtz += signOf(dtz);
+        }
+        if (dtz == 2 && pPosition.checkers() && !hasLegalMoves(pPosition)) {
+            dtz = 1;
+        }
+        pPosition.undoMove();
+        if (state == EProbeState::FAIL) {
+            return false;
+        }
+
+        // Wins zeroing in time rank above those that don't, the soonest
+        // first; losses rank the latest first, which also reaches the
+        // fifty-move draw whenever it can
+        int rank = 0;
+        if (dtz > 0) {
+            rank = dtz + halfmoves <= 99 ? kMaxDtz - dtz : kMaxDtz - 100 - (dtz + halfmoves);
+        } else if (dtz < 0) {
+            rank = -kMaxDtz - dtz + halfmoves;
+        }
+        if (rank > bestRank) {
+            bestRank = rank;
+            pBestMoves.clear();
+        }
+        if (rank == bestRank) {
+            pBestMoves.push_back(move);
+        }
+    }
+    if (moves.empty()) {
+        return false;
+    }
+    pScore = bestRank > kMaxDtz - 100   ? kWinScore
+             : bestRank < -kMaxDtz + 100 ? -kWinScore
+                                         : 0;
+    return true;
+}
@@ -0,0 +1,135 @@
+#include "transposition_table.h"
+
+#include <algorithm>
+#include <atomic>
+
+TranspositionTable::TranspositionTable(size_t pMegabytes)
+    : mBucketCount(0)
+    , mMegabytes(0)
+    , mGeneration(0) {
+    resize(pMegabytes);
+}
+
+void TranspositionTable::resize(size_t pMegabytes) {
+    pMegabytes = std::max<size_t>(pMegabytes, 1);
+    // Round down to a power of two so the bucket index is a mask
+    size_t count = pMegabytes * 1024 * 1024 / sizeof(Bucket);
+    size_t buckets = 1;
+    while (buckets * 2 <= count) {
+        buckets *= 2;
+    }
+    mBuckets.reset(new Bucket[buckets]);
+    mBucketCount = buckets;
+    mMegabytes = pMegabytes;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < mBucketCount; i++) {
+        for (Slot &slot : mBuckets[i].mSlots) {
+            slot.mKeyXorData.store(0, std::memory_order_relaxed);
+            slot.mData.store(0, std::memory_order_relaxed);
+        }
+    }
+    mGeneration = 0;
+}
+
+void TranspositionTable::newSearch() { mGeneration = (mGeneration + 1) & 63; }
+
+// Data layout: move (16 bits) | score (16) | depth (8) | generation (6) and bound (2)
+uint64_t TranspositionTable::pack(const TTEntry &pEntry) {
+    return uint64_t(pEntry.mMove.raw()) | uint64_t(uint16_t(pEntry.mScore)) << 16 |
+           uint64_t(uint8_t(pEntry.mDepth)) << 32 |
+           uint64_t(pEntry.mGeneration << 2 | static_cast<int>(pEntry.mBound)) << 40;
+}
+
+TTEntry TranspositionTable::unpack(uint64_t pData) {
+    TTEntry entry;
+    entry.mMove = PositionMove::fromRaw(pData & 0xFFFF);
+    entry.mScore = static_cast<int16_t>((pData >> 16) & 0xFFFF);
+    entry.mDepth = static_cast<int8_t>((pData >> 32) & 0xFF);
+    entry.mBound = static_cast<EBound>((pData >> 40) & 3);
+    entry.mGeneration = static_cast<uint8_t>((pData >> 42) & 63);
+    return entry;
+}
+
+TranspositionTable::Bucket &TranspositionTable::bucketFor(uint64_t pKey) const {
+    return mBuckets[pKey & (mBucketCount - 1)];
+}
+
+int TranspositionTable::age(const TTEntry &pEntry) const {
+    return (mGeneration - pEntry.mGeneration) & 63;
+}
+
+bool TranspositionTable::probe(uint64_t pKey, TTEntry &pEntry) const {
+    for (const Slot &slot : bucketFor(pKey).mSlots) {
+        uint64_t data = slot.mData.load(std::memory_order_relaxed);
+        uint64_t keyXorData = slot.mKeyXorData.load(std::memory_order_relaxed);
+        if ((keyXorData ^ data) == pKey && data) {
+            pEntry = unpack(data);
+            return pEntry.mBound != EBound::NONE;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t pKey, int pDepth, int pScore, EBound pBound,
+                               const PositionMove &pMove) {
+    Bucket &bucket = bucketFor(pKey);
+    Slot *replace = nullptr;
+    TTEntry existing;
+    for (Slot &slot : bucket.mSlots) {
+        uint64_t data = slot.mData.load(std::memory_order_relaxed);
+        if ((slot.mKeyXorData.load(std::memory_order_relaxed) ^ data) == pKey && data) {
+            existing = unpack(data);
+            // Keep a deeper bound from this search over a shallower one
+            if (pDepth < existing.mDepth && pBound != EBound::EXACT && age(existing) == 0) {
+                return;
+            }
+            replace = &slot;
+            break;
+        }
+    }
+    if (!replace) {
+        // Otherwise evict the least valuable slot; each search of age costs two plies
+        int worst = 0;
+        for (Slot &slot : bucket.mSlots) {
+            TTEntry entry = unpack(slot.mData.load(std::memory_order_relaxed));
+            if (entry.mBound == EBound::NONE) {
+                replace = &slot;
+                break;
+            }
+            int value = entry.mDepth - 2 * age(entry);
+            if (!replace || value < worst) {
+                replace = &slot;
+                worst = value;
+            }
+        }
+    }
+
+    TTEntry entry;
+    entry.mMove = pMove;
+    entry.mScore = static_cast<int16_t>(pScore);
+    entry.mDepth = static_cast<int8_t>(pDepth);
+    entry.mBound = pBound;
+    entry.mGeneration = mGeneration;
+    uint64_t data = pack(entry);
+    replace->mKeyXorData.store(pKey ^ data, std::memory_order_relaxed);
+    replace->mData.store(data, std::memory_order_relaxed);
+}
+
+size_t TranspositionTable::sizeInMegabytes() const { return mMegabytes; }
+
+int TranspositionTable::hashfull() const {
+    int used = 0;
+    size_t samples = std::min<size_t>(1000 / kBucketSize, mBucketCount);
+    for (size_t i = 0; i < samples; i++) {
+        for (const Slot &slot : mBuckets[i].mSlots) {
+            TTEntry entry = unpack(slot.mData.load(std::memory_order_relaxed));
+            if (entry.mBound != EBound::NONE && age(entry) == 0) {
+                used++;
+            }
+        }
+    }
+    return samples ? used * 1000 / static_cast<int>(samples * kBucketSize) : 0;
+}
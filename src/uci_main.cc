@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "evaluation.h"
+#include "movegen.h"
+#include "opening_book.h"
+#include "position.h"
+#include "search.h"
+#include "tablebase.h"
+#include "transposition_table.h"
+
+// Time kept back per move for communication with the GUI
+static constexpr int64_t kMoveOverheadMs = 30;
+// Moves the remaining clock time is spread over when the GUI sends no movestogo
+static constexpr int kDefaultMovesToGo = 30;
+
+static std::string formatScore(int pScore) {
+    if (std::abs(pScore) < kMateBound) {
+        return "cp " + std::to_string(pScore);
+    }
+    // Mate scores count plies; UCI counts moves
+    int plies = kMateScore - std::abs(pScore);
+    int moves = (plies + 1) / 2;
+    return "mate " + std::to_string(pScore > 0 ? moves : -moves);
+}
+
+// UCI front-end. Commands are read on the main thread while the search runs on
+// a thread of its own, so stop, isready and quit are answered mid-search.
+class UciSession {
+   public:
+    UciSession();
+    ~UciSession();
+    // Returns false once the GUI has sent quit
+    bool handle(const std::string &pLine);
+
+   private:
+    void identify();
+    void setOption(std::istringstream &pArgs);
+    void setPosition(std::istringstream &pArgs);
+    void go(std::istringstream &pArgs);
+    // The opponent played the expected move: the ponder search gives way to a
+    // timed one from the same position, which finds the table already warm
+    void ponderHit();
+    void startSearch(const SearchLimits &pLimits, bool pInfinite);
+    void runSearch(Position pPosition, SearchLimits pLimits, bool pInfinite);
+    // Stops a running search; its bestmove is still sent before this returns
+    // unless pDiscard is set
+    void stopSearch(bool pDiscard = false);
+    void sendInfo(const SearchResult &pResult);
+    void send(const std::string &pLine);
+
+    TranspositionTable mTable;
+    int mThreads;
+    Position mPosition;
+    OpeningBook mBook;
+    bool mOwnBook;
+    // Sends each search's statistics as JSON before its bestmove
+    bool mSearchStats;
+    // Whether the GUI ponders; only then is a ponder move suggested
+    bool mPonder;
+    // While pondering, the limits the search gets once ponderhit arrives
+    bool mPondering;
+    SearchLimits mPonderLimits;
+    std::mt19937 mRng;
+    std::unique_ptr<Search> mSearch;
+    std::thread mSearchThread;
+    std::mutex mOutputMutex;
+    // An infinite search holds its bestmove back until the GUI sends stop
+    std::mutex mStopMutex;
+    std::condition_variable mStopSignal;
+    bool mStopRequested;
+    // Set with mStopRequested when the stopped search's bestmove is unwanted
+    bool mDiscardResult;
+};
+
+UciSession::UciSession()
+    : mThreads(1)
+    , mOwnBook(false)
+    , mSearchStats(false)
+    , mPonder(false)
+    , mPondering(false)
+    , mRng(std::random_device()())
+    , mStopRequested(false)
+    , mDiscardResult(false) {
+    mPosition.setStartPosition();
+    mBook.open(kDefaultBookPath);
+    Tablebases::init(kDefaultTablebasePath);
+}
+
+UciSession::~UciSession() { stopSearch(); }
+
+bool UciSession::handle(const std::string &pLine) {
+    std::istringstream args(pLine);
+    std::string command;
+    args >> command;
+    if (command == "uci") {
+        identify();
+    } else if (command == "isready") {
+        send("readyok");
+    } else if (command == "setoption") {
+        setOption(args);
+    } else if (command == "ucinewgame") {
+        stopSearch();
+        mTable.clear();
+    } else if (command == "position") {
+        setPosition(args);
+    } else if (command == "go") {
+        go(args);
+    } else if (command == "ponderhit") {
+        ponderHit();
+    } else if (command == "stop") {
+        stopSearch();
+    } else if (command == "quit") {
+        stopSearch();
+        return false;
+    }
+    // Unknown commands and debug are ignored as the protocol allows
+    return true;
+}
+
+void UciSession::identify() {
+    send("id name ChessEngine");
+    send("id author Abd al-Rahman Atef");
+    send("option name Hash type spin default " +
+         std::to_string(TranspositionTable::kDefaultMegabytes) + " min 1 max 65536");
+    send("option name Threads type spin default 1 min 1 max " +
+         std::to_string(Search::kMaxThreads));
+    send("option name Ponder type check default false");
+    send("option name OwnBook type check default false");
+    send(std::string("option name BookFile type string default ") + kDefaultBookPath);
+    send(std::string("option name SyzygyPath type string default ") + kDefaultTablebasePath);
+    send("option name SearchStats type check default false");
+    send("uciok");
+}
+
+void UciSession::setOption(std::istringstream &pArgs) {
+    // setoption name <id> [value <x>]; both may contain spaces
+    std::string token, name, value;
+    std::string *field = nullptr;
+    while (pArgs >> token) {
+        if (token == "name") {
+            field = &name;
+        } else if (token == "value") {
+            field = &value;
+        } else if (field) {
+            *field += (field->empty() ? "" : " ") + token;
+        }
+    }
+
+    // None of these can change under a running search
+    stopSearch();
+    if (name == "Hash") {
+        mTable.resize(std::clamp(std::atoi(value.c_str()), 1, 65536));
+    } else if (name == "Threads") {
+        mThreads = std::clamp(std::atoi(value.c_str()), 1, Search::kMaxThreads);
+    } else if (name == "Ponder") {
+        mPonder = value == "true";
+    } else if (name == "OwnBook") {
+        mOwnBook = value == "true";
+    } else if (name == "BookFile" && !mBook.open(value)) {
+        send("info string cannot open book " + value);
+    } else if (name == "SearchStats") {
+        mSearchStats = value == "true";
+    } else if (name == "SyzygyPath") {
+        send("info string " + std::to_string(Tablebases::init(value)) + " tablebases found");
+    }
+}
+
+void UciSession::setPosition(std::istringstream &pArgs) {
+    stopSearch();
+    std::string token;
+    pArgs >> token;
+    if (token == "startpos") {
+        mPosition.setStartPosition();
+        pArgs >> token;
+    } else if (token == "fen") {
+        std::string fen;
+        while (pArgs >> token && token != "moves") {
+            fen += (fen.empty() ? "" : " ") + token;
+        }
+        if (!mPosition.setFromFen(fen)) {
+            send("info string invalid fen " + fen);
+            mPosition.setStartPosition();
+            return;
+        }
+    } else {
+        return;
+    }
+
+    if (token != "moves") {
+        return;
+    }
+    while (pArgs >> token) {
+        PositionMove move = parseUciMove(mPosition, token);
+        if (move.isNull()) {
+            send("info string illegal move " + token);
+            return;
+        }
+        mPosition.makeMove(move);
+    }
+}
+
+void UciSession::go(std::istringstream &pArgs) {
+    stopSearch();
+    SearchLimits limits;
+    bool infinite = false, ponder = false;
+    int64_t whiteTime = 0, blackTime = 0, whiteIncrement = 0, blackIncrement = 0;
+    int64_t moveTime = 0;
+    int movesToGo = 0;
+    std::string token;
+    while (pArgs >> token) {
+        if (token == "depth") {
+            pArgs >> limits.mMaxDepth;
+        } else if (token == "nodes") {
+            pArgs >> limits.mMaxNodes;
+        } else if (token == "movetime") {
+            pArgs >> moveTime;
+        } else if (token == "wtime") {
+            pArgs >> whiteTime;
+        } else if (token == "btime") {
+            pArgs >> blackTime;
+        } else if (token == "winc") {
+            pArgs >> whiteIncrement;
+        } else if (token == "binc") {
+            pArgs >> blackIncrement;
+        } else if (token == "movestogo") {
+            pArgs >> movesToGo;
+        } else if (token == "infinite") {
+            infinite = true;
+        } else if (token == "ponder") {
+            ponder = true;
+        }
+    }
+
+    const bool white = mPosition.sideToMove() == EPieceColor::WHITE;
+    const int64_t clock = white ? whiteTime : blackTime;
+    const int64_t increment = white ? whiteIncrement : blackIncrement;
+    if (moveTime > 0) {
+        limits.mSoftTimeMs = limits.mHardTimeMs = std::max<int64_t>(1, moveTime - kMoveOverheadMs);
+    } else if (clock > 0 && !infinite) {
+        // An even share of the clock plus the increment, never more than half
+        // of what is left; like the GUI, no iteration starts past half of it
+        int64_t available = std::max<int64_t>(1, clock - kMoveOverheadMs);
+        int64_t share = available / (movesToGo > 0 ? movesToGo : kDefaultMovesToGo) + increment;
+        int64_t budget = std::max<int64_t>(1, std::min(share, available / 2));
+        limits.mSoftTimeMs = std::max<int64_t>(1, budget / 2);
+        limits.mHardTimeMs = budget;
+    }
+
+    // Pondering searches without a clock and, like infinite analysis, holds
+    // its bestmove until stop; the limits apply from ponderhit on
+    if (ponder) {
+        mPonderLimits = limits;
+        limits.mSoftTimeMs = limits.mHardTimeMs = 0;
+        mPondering = true;
+        startSearch(limits, true);
+        return;
+    }
+
+    // Infinite analysis wants a search even in the book
+    PositionMove bookMove = mOwnBook && !infinite ? mBook.pick(mPosition, mRng) : PositionMove();
+    if (!bookMove.isNull()) {
+        send("bestmove " + moveToUci(bookMove));
+        return;
+    }
+    startSearch(limits, infinite);
+}
+
+void UciSession::ponderHit() {
+    if (!mPondering) {
+        return;
+    }
+    stopSearch(true);
+    startSearch(mPonderLimits, false);
+}
+
+void UciSession::startSearch(const SearchLimits &pLimits, bool pInfinite) {
+    mStopRequested = false;
+    mDiscardResult = false;
+    mSearch = std::make_unique<Search>(mTable, mThreads);
+    mSearch->setIterationCallback([this](const SearchResult &pResult) { sendInfo(pResult); });
+    mSearchThread = std::thread(&UciSession::runSearch, this, mPosition, pLimits, pInfinite);
+}
+
+void UciSession::runSearch(Position pPosition, SearchLimits pLimits, bool pInfinite) {
+    SearchResult result = mSearch->run(pPosition, pLimits);
+    if (pInfinite) {
+        std::unique_lock<std::mutex> lock(mStopMutex);
+        mStopSignal.wait(lock, [this] { return mStopRequested; });
+        if (mDiscardResult) {
+            return;
+        }
+    }
+    if (mSearchStats) {
+        send("info string stats " + searchStatsJson(result));
+    }
+    if (result.mBestMove.isNull()) {
+        // Mated or stalemated at the root
+        send("info depth 0 score " + formatScore(result.mScore));
+        send("bestmove 0000");
+        return;
+    }
+    std::string line = "bestmove " + moveToUci(result.mBestMove);
+    if (mPonder && result.mPrincipalVariation.size() > 1) {
+        line += " ponder " + moveToUci(result.mPrincipalVariation[1]);
+    }
+    send(line);
+}
+
+void UciSession::stopSearch(bool pDiscard) {
+    mPondering = false;
+    if (!mSearchThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mStopMutex);
+        mStopRequested = true;
+        mDiscardResult = pDiscard;
+    }
+    mStopSignal.notify_one();
+    mSearch->stop();
+    mSearchThread.join();
+    mSearch.reset();
+}
+
+void UciSession::sendInfo(const SearchResult &pResult) {
+    uint64_t nps = nodesPerSecond(pResult.mNodes, pResult.mTimeMs);
+    std::string line = "info depth " + std::to_string(pResult.mDepth) + " score " +
+                       formatScore(pResult.mScore) + " nodes " + std::to_string(pResult.mNodes) +
+                       " nps " + std::to_string(nps) + " hashfull " +
+                       std::to_string(mTable.hashfull()) + " time " +
+                       std::to_string(pResult.mTimeMs) + " pv";
+    for (auto &move : pResult.mPrincipalVariation) {
+        line += " " + moveToUci(move);
+    }
+    send(line);
+}
+
+void UciSession::send(const std::string &pLine) {
+    // The search thread reports while the main thread answers commands
+    std::lock_guard<std::mutex> lock(mOutputMutex);
+    std::fputs(pLine.c_str(), stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+}
+
+int main() {
+    UciSession session;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!session.handle(line)) {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "zobrist.h"
+
+uint64_t Zobrist::mPieceKeys[kColorCount * kPieceTypeCount][kSquareCount];
+uint64_t Zobrist::mCastlingKeys[16];
+uint64_t Zobrist::mEnPassantKeys[8];
+uint64_t Zobrist::mSideKey;
+
+void Zobrist::init() {
+    static const bool sInitialized = [] {
+        // splitmix64 keeps the keys identical across runs and platforms
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        auto next = [&state] {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+        for (auto &pieceKeys : mPieceKeys) {
+            for (auto &key : pieceKeys) {
+                key = next();
+            }
+        }
+        // Each castling right gets its own key, combinations are xor-ed together
+        uint64_t rightKeys[4];
+        for (auto &key : rightKeys) {
+            key = next();
+        }
+        for (int rights = 0; rights < 16; rights++) {
+            mCastlingKeys[rights] = 0;
+            for (int bit = 0; bit < 4; bit++) {
+                if (rights & (1 << bit)) {
+                    mCastlingKeys[rights] ^= rightKeys[bit];
+                }
+            }
+        }
+        for (auto &key : mEnPassantKeys) {
+            key = next();
+        }
+        mSideKey = next();
+        return true;
+    }();
+    (void)sInitialized;
+}